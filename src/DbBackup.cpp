@@ -0,0 +1,153 @@
+#include "pch.h"
+#include "DbBackup.h"
+#include <chrono>
+
+
+DbBackup::DbBackup(const DbConnectionPtr& pFrom, const DbConnectionPtr& pTo,
+                   const std::string& from_schema, const std::string& to_schema)
+  : pFrom_(pFrom),
+    pTo_(pTo),
+    backup_(NULL),
+    background_(false),
+    running_(false),
+    stop_(false),
+    rc_(SQLITE_OK),
+    remaining_(0),
+    pagecount_(0) {
+
+  backup_ = sqlite3_backup_init(pTo_->conn(), to_schema.c_str(),
+                                pFrom_->conn(), from_schema.c_str());
+  if (backup_ == NULL) {
+    stop("Could not start backup:\n%s", pTo_->getException());
+  }
+}
+
+DbBackup::~DbBackup() {
+  try {
+    stop_ = true;
+    join();
+    end_background();
+    if (backup_) sqlite3_backup_finish(backup_);
+  } catch (...) {}
+}
+
+void DbBackup::run(int pages, int sleep_ms, SEXP progress) {
+  if (!backup_ || running_) stop("Backup is already running or finished");
+
+  for (;;) {
+    int rc = step(pages);
+    if (rc != SQLITE_OK && rc != SQLITE_DONE && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) {
+      raise_exception(rc);
+    }
+
+    if (!Rf_isNull(progress)) {
+      Function rfun = progress;
+      rfun(remaining(), pagecount());
+    }
+    if (rc == SQLITE_DONE) break;
+
+    checkUserInterrupt();
+    if (sleep_ms > 0) {
+      sqlite3_sleep(sleep_ms);
+    } else if (rc != SQLITE_OK) {
+      // Source or destination locked, give the other side a chance
+      sqlite3_sleep(10);
+    }
+  }
+
+  finish();
+}
+
+void DbBackup::start(int pages, int sleep_ms) {
+  if (!backup_ || running_ || thread_.joinable()) stop("Backup is already running or finished");
+  if (pFrom_->has_r_busy_handler() || pTo_->has_r_busy_handler()) {
+    stop("Cannot copy in the background with an R busy handler, use a timeout instead");
+  }
+
+  pFrom_->begin_background();
+  pTo_->begin_background();
+  background_ = true;
+  running_ = true;
+  try {
+    thread_ = std::thread(&DbBackup::run_thread, this, pages, sleep_ms);
+  } catch (...) {
+    running_ = false;
+    end_background();
+    stop("Could not start background thread");
+  }
+}
+
+bool DbBackup::is_running() const {
+  return running_;
+}
+
+int DbBackup::remaining() const {
+  return remaining_;
+}
+
+int DbBackup::pagecount() const {
+  return pagecount_;
+}
+
+void DbBackup::wait() {
+  while (running_) {
+    // Interruptible, the thread keeps running
+    checkUserInterrupt();
+    sqlite3_sleep(50);
+  }
+  finish();
+}
+
+void DbBackup::finish() {
+  join();
+  end_background();
+  if (!backup_) return;
+
+  int step_rc = rc_;
+  int rc = sqlite3_backup_finish(backup_);
+  backup_ = NULL;
+  pFrom_.reset();
+  pTo_.reset();
+
+  if (step_rc != SQLITE_DONE) {
+    if (rc == SQLITE_OK) stop("Backup was aborted before all data was copied");
+    raise_exception(rc);
+  }
+  if (rc != SQLITE_OK) {
+    raise_exception(rc);
+  }
+}
+
+int DbBackup::step(int pages) {
+  int rc = sqlite3_backup_step(backup_, pages);
+  remaining_ = sqlite3_backup_remaining(backup_);
+  pagecount_ = sqlite3_backup_pagecount(backup_);
+  rc_ = rc;
+  return rc;
+}
+
+void DbBackup::run_thread(int pages, int sleep_ms) {
+  while (!stop_) {
+    int rc = step(pages);
+    if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) break;
+
+    int ms = (sleep_ms > 0 || rc == SQLITE_OK) ? sleep_ms : 10;
+    if (ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  }
+  running_ = false;
+}
+
+void DbBackup::join() {
+  if (thread_.joinable()) thread_.join();
+}
+
+void DbBackup::end_background() {
+  if (!background_) return;
+  background_ = false;
+  pFrom_->end_background();
+  pTo_->end_background();
+}
+
+void DbBackup::raise_exception(int rc) const {
+  stop("Failed to copy all data:\n%s", sqlite3_errstr(rc));
+}
@@ -0,0 +1,71 @@
+#ifndef __RSQLITE_DB_BACKUP__
+#define __RSQLITE_DB_BACKUP__
+
+#include <boost/noncopyable.hpp>
+#include <atomic>
+#include <thread>
+#include "DbConnection.h"
+
+// Online backup ---------------------------------------------------------------
+
+// Copies a database in steps of a number of pages with sqlite3_backup_step(),
+// so that the source is locked only while a step is running.
+// The backup restarts automatically if the source is modified by another
+// connection, changes made through the source connection are copied along.
+//
+// run() copies in the calling thread, start() in a background thread that
+// does not call into R: sqlite3_backup_step() calls the busy handlers of both
+// connections, so start() fails if one of them is an R function, and R busy
+// handlers cannot be set until the backup is finished.  Both connections are
+// kept alive until the backup is finished.
+
+class DbBackup : boost::noncopyable {
+public:
+  DbBackup(const DbConnectionPtr& pFrom, const DbConnectionPtr& pTo,
+           const std::string& from_schema = "main",
+           const std::string& to_schema = "main");
+  ~DbBackup();
+
+public:
+  // Copies the database, calling progress(remaining, pagecount) after each
+  // step unless it is NULL
+  void run(int pages, int sleep_ms, SEXP progress);
+
+  // Copies the database in a background thread
+  void start(int pages, int sleep_ms);
+
+  // Is the background thread still copying?
+  bool is_running() const;
+
+  // Pages left to copy and total number of pages after the last step
+  int remaining() const;
+  int pagecount() const;
+
+  // Waits for the background thread, fails if the backup failed
+  void wait();
+
+  // Releases the backup, fails if it did not complete; an unfinished
+  // backup is aborted
+  void finish();
+
+private:
+  int step(int pages);
+  void run_thread(int pages, int sleep_ms);
+  void join();
+  void end_background();
+  void NORET raise_exception(int rc) const;
+
+private:
+  DbConnectionPtr pFrom_;
+  DbConnectionPtr pTo_;
+  sqlite3_backup* backup_;
+  std::thread thread_;
+  bool background_;
+  std::atomic<bool> running_;
+  std::atomic<bool> stop_;
+  std::atomic<int> rc_;
+  std::atomic<int> remaining_;
+  std::atomic<int> pagecount_;
+};
+
+#endif // __RSQLITE_DB_BACKUP__
@@ -4,13 +4,16 @@
 #include "DbColumnStorage.h"
 
 
-DbColumn::DbColumn(DATA_TYPE dt, const int n_max_, DbColumnDataSourceFactory* factory, const int j)
+DbColumn::DbColumn(DATA_TYPE dt, const int n_max_, DbColumnDataSourceFactory* factory, const int j,
+                   const bool fixed_, const DATA_TYPE bigint_)
   : source(factory->create(j)),
-    n(0)
+    n(0),
+    fixed(fixed_),
+    bigint(bigint_)
 {
-  if (dt == DT_BOOL)
+  if (dt == DT_BOOL && !fixed)
     dt = DT_UNKNOWN;
-  storage.push_back(new DbColumnStorage(dt, 0, n_max_, *source));
+  storage.push_back(new DbColumnStorage(dt, 0, n_max_, *source, fixed));
 }
 
 DbColumn::~DbColumn() {
@@ -18,8 +21,10 @@ DbColumn::~DbColumn() {
 
 void DbColumn::set_col_value() {
   DbColumnStorage* last = get_last_storage();
-  DATA_TYPE dt = last->get_item_data_type();
-  data_types_seen.insert(dt);
+  if (!fixed) {
+    DATA_TYPE dt = last->get_item_data_type();
+    data_types_seen.insert(dt);
+  }
 
   DbColumnStorage* next = last->append_col();
   if (last != next) storage.push_back(next);
@@ -29,6 +34,24 @@ void DbColumn::finalize(const int n_) {
   n = n_;
 }
 
+// Keeps the last storage, which has the latest type, for the next chunk
+void DbColumn::reset(const int n_max) {
+  DbColumnStorage* last = get_last_storage();
+  if (last->reset(n_max)) {
+    storage.erase(storage.begin(), storage.end() - 1);
+  }
+  else {
+    DATA_TYPE dt = last->get_data_type();
+    if (dt == DT_BOOL && !fixed)
+      dt = DT_UNKNOWN;
+    storage.clear();
+    storage.push_back(new DbColumnStorage(dt, n_max, n_max, *source, fixed));
+  }
+
+  n = 0;
+  data_types_seen.clear();
+}
+
 void DbColumn::warn_type_conflicts(const String& name) const {
   std::set<DATA_TYPE> my_data_types_seen = data_types_seen;
   DATA_TYPE dt = get_last_storage()->get_data_type();
@@ -71,8 +94,16 @@ void DbColumn::warn_type_conflicts(const String& name) const {
 }
 
 DbColumn::operator SEXP() const {
+  return get_data(R_NilValue);
+}
+
+SEXP DbColumn::get_data(SEXP x) const {
   DATA_TYPE dt = get_last_storage()->get_data_type();
-  SEXP ret = PROTECT(DbColumnStorage::allocate(n, dt));
+  if (dt == DT_INT64 && !fixed)
+    dt = bigint;
+
+  const bool reuse = !Rf_isNull(x) && !MAYBE_SHARED(x) && Rf_xlength(x) == n;
+  SEXP ret = PROTECT(reuse ? x : DbColumnStorage::allocate(n, dt));
   int pos = 0;
   for (size_t k = 0; k < storage.size(); ++k) {
     const DbColumnStorage& current = storage[k];
@@ -16,18 +16,30 @@ private:
   boost::shared_ptr<DbColumnDataSource> source;
   boost::ptr_vector<DbColumnStorage> storage;
   int n;
+  bool fixed;
+  DATA_TYPE bigint;
   std::set<DATA_TYPE> data_types_seen;
 
 public:
-  DbColumn(DATA_TYPE dt_, const int n_max_, DbColumnDataSourceFactory* factory, const int j);
+  // With fixed = true, dt_ is used for all values without looking at their types;
+  // otherwise, 64-bit integers are returned as bigint_
+  DbColumn(DATA_TYPE dt_, const int n_max_, DbColumnDataSourceFactory* factory, const int j,
+           const bool fixed_ = false, const DATA_TYPE bigint_ = DT_INT64);
   ~DbColumn();
 
 public:
   void set_col_value();
   void finalize(const int n_);
+  void reset(const int n_max);
   void warn_type_conflicts(const String& name) const;
 
   operator SEXP() const;
+
+  // Copies the values into x if it has the right length and nothing else
+  // refers to it, otherwise into a new vector; x must have the type of the
+  // column or be R_NilValue
+  SEXP get_data(SEXP x) const;
+
   DATA_TYPE get_type() const;
   static const char* format_data_type(const DATA_TYPE dt);
 
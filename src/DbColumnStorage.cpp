@@ -7,12 +7,13 @@
 using namespace Rcpp;
 
 DbColumnStorage::DbColumnStorage(DATA_TYPE dt_, const R_xlen_t capacity_, const int n_max_,
-                                 const DbColumnDataSource& source_)
+                                 const DbColumnDataSource& source_, const bool fixed_)
   :
   i(0),
   dt(dt_),
   n_max(n_max_),
-  source(source_)
+  source(source_),
+  fixed(fixed_)
 {
   data = allocate(get_new_capacity(capacity_), dt);
 }
@@ -25,6 +26,11 @@ DbColumnStorage* DbColumnStorage::append_col() {
   return append_data();
 }
 
+bool DbColumnStorage::reset(const int n_max_) {
+  i = 0;
+  return dt != DT_UNKNOWN && get_capacity() >= n_max_;
+}
+
 DATA_TYPE DbColumnStorage::get_item_data_type() const {
   return source.get_data_type();
 }
@@ -87,9 +93,11 @@ void DbColumnStorage::fill_default_value() {
 DbColumnStorage* DbColumnStorage::append_data() {
   if (dt == DT_UNKNOWN) return append_data_to_new(dt);
   if (i >= get_capacity()) return append_data_to_new(dt);
-  DATA_TYPE new_dt = source.get_data_type();
-  if (dt == DT_INT && new_dt == DT_INT64) return append_data_to_new(DT_INT64);
-  if (dt == DT_INT && new_dt == DT_REAL) return append_data_to_new(DT_REAL);
+  if (!fixed) {
+    DATA_TYPE new_dt = source.get_data_type();
+    if (dt == DT_INT && new_dt == DT_INT64) return append_data_to_new(DT_INT64);
+    if (dt == DT_INT && new_dt == DT_REAL) return append_data_to_new(DT_REAL);
+  }
 
   fetch_value();
   ++i;
@@ -101,7 +109,7 @@ DbColumnStorage* DbColumnStorage::append_data_to_new(DATA_TYPE new_dt) {
 
   R_xlen_t desired_capacity = (n_max < 0) ? (get_capacity() * 2) : (n_max - i);
 
-  DbColumnStorage* spillover = new DbColumnStorage(new_dt, desired_capacity, n_max, source);
+  DbColumnStorage* spillover = new DbColumnStorage(new_dt, desired_capacity, n_max, source, fixed);
   return spillover->append_data();
 }
 
@@ -264,6 +272,12 @@ void DbColumnStorage::fill_default_value(SEXP data, DATA_TYPE dt, R_xlen_t i) {
   }
 }
 
+SEXP DbColumnStorage::format_int64(const int64_t value) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(value));
+  return Rf_mkChar(buf);
+}
+
 void DbColumnStorage::copy_value(SEXP x, DATA_TYPE dt, const int tgt, const int src) const {
   if (Rf_isNull(data)) {
     fill_default_value(x, dt, tgt);
@@ -275,7 +289,19 @@ void DbColumnStorage::copy_value(SEXP x, DATA_TYPE dt, const int tgt, const int
       break;
 
     case DT_INT:
-      INTEGER(x)[tgt] = INTEGER(data)[src];
+      if (this->dt == DT_INT64) {
+        // bigint = "integer", out of range values become NA
+        const int64_t value = INTEGER64(data)[src];
+        if (value == NA_INTEGER64 || value <= INT_MIN || value > INT_MAX) {
+          INTEGER(x)[tgt] = NA_INTEGER;
+        }
+        else {
+          INTEGER(x)[tgt] = static_cast<int>(value);
+        }
+      }
+      else {
+        INTEGER(x)[tgt] = INTEGER(data)[src];
+      }
       break;
 
     case DT_INT64:
@@ -312,13 +338,36 @@ void DbColumnStorage::copy_value(SEXP x, DATA_TYPE dt, const int tgt, const int
         break;
 
       case REALSXP:
-        REAL(x)[tgt] = REAL(data)[src];
+        if (this->dt == DT_INT64) {
+          // bigint = "numeric"
+          const int64_t value = INTEGER64(data)[src];
+          REAL(x)[tgt] = (value == NA_INTEGER64) ? NA_REAL : static_cast<double>(value);
+        }
+        else {
+          REAL(x)[tgt] = REAL(data)[src];
+        }
         break;
       }
       break;
 
     case DT_STRING:
-      SET_STRING_ELT(x, tgt, STRING_ELT(data, src));
+      switch (this->dt) {
+      case DT_INT: {
+          // bigint = "character", for the values before the first 64-bit one
+          const int value = INTEGER(data)[src];
+          SET_STRING_ELT(x, tgt, (value == NA_INTEGER) ? NA_STRING : format_int64(value));
+          break;
+        }
+
+      case DT_INT64: {
+          const int64_t value = INTEGER64(data)[src];
+          SET_STRING_ELT(x, tgt, (value == NA_INTEGER64) ? NA_STRING : format_int64(value));
+          break;
+        }
+
+      default:
+        SET_STRING_ELT(x, tgt, STRING_ELT(data, src));
+      }
       break;
 
     case DT_BLOB:
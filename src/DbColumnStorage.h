@@ -13,14 +13,20 @@ class DbColumnStorage {
   DATA_TYPE dt;
   const int n_max;
   const DbColumnDataSource& source;
+  const bool fixed;
 
 public:
-  DbColumnStorage(DATA_TYPE dt_, const R_xlen_t capacity_, const int n_max_, const DbColumnDataSource& source_);
+  DbColumnStorage(DATA_TYPE dt_, const R_xlen_t capacity_, const int n_max_, const DbColumnDataSource& source_,
+                  const bool fixed_ = false);
   ~DbColumnStorage();
 
 public:
   DbColumnStorage* append_col();
 
+  // Empties the storage for the next chunk of n_max_ rows,
+  // returns false if it has too little capacity
+  bool reset(const int n_max_);
+
   DATA_TYPE get_item_data_type() const;
   DATA_TYPE get_data_type() const;
   static SEXP allocate(const R_xlen_t length, DATA_TYPE dt);
@@ -50,6 +56,7 @@ private:
   // copy_to()
   static void fill_default_value(SEXP data, DATA_TYPE dt, R_xlen_t i);
   void copy_value(SEXP x, DATA_TYPE dt, const int tgt, const int src) const;
+  static SEXP format_int64(const int64_t value);
 };
 
 
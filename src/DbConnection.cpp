@@ -1,11 +1,82 @@
 #include "pch.h"
 #include "DbConnection.h"
+#include "SqliteArray.h"
+#include "SqliteRFunction.h"
+#include "vfs.h"
+#include <algorithm>
 
+// The extensions are compiled with SQLITE_CORE, their entry points are
+// called directly and ignore the API routines.
+extern "C" {
+  int sqlite3_math_init(sqlite3* db, char** pzErrMsg, const sqlite3_api_routines* pApi);
+  int sqlite3_regexp_init(sqlite3* db, char** pzErrMsg, const sqlite3_api_routines* pApi);
+  int sqlite3_series_init(sqlite3* db, char** pzErrMsg, const sqlite3_api_routines* pApi);
+  int sqlite3_csv_init(sqlite3* db, char** pzErrMsg, const sqlite3_api_routines* pApi);
+}
+
+typedef int (*extension_init_fun)(sqlite3*, char**, const sqlite3_api_routines*);
+
+static extension_init_fun find_extension(const std::string& name) {
+  if (name == "math") return sqlite3_math_init;
+  if (name == "regexp") return sqlite3_regexp_init;
+  if (name == "series") return sqlite3_series_init;
+  if (name == "csv") return sqlite3_csv_init;
+  stop("Unknown extension: %s", name.c_str());
+  return NULL;
+}
+
+
+// VFS shims are registered on first use.  A name like "compress/unix-dotfile"
+// layers the "compress" shim on top of the "unix-dotfile" VFS, a name without
+// a slash uses the default VFS.
+static void prepare_vfs(const std::string& vfs) {
+  if (vfs.empty() || sqlite3_vfs_find(vfs.c_str()) != NULL) return;
+
+  size_t slash = vfs.find('/');
+  std::string shim = vfs.substr(0, slash);
+  std::string base = (slash == std::string::npos) ? "" : vfs.substr(slash + 1);
+  prepare_vfs(base);
+
+  const char* zBase = base.empty() ? NULL : base.c_str();
+  int rc;
+  if (shim == "compress") {
+    rc = RSQLite_register_compress_vfs(vfs.c_str(), zBase);
+  }
+  else if (shim == "stats") {
+    rc = RSQLite_register_stats_vfs(vfs.c_str(), zBase);
+  }
+  else if (shim == "readahead") {
+    rc = RSQLite_register_readahead_vfs(vfs.c_str(), zBase);
+  }
+  else {
+    // Not a shim, sqlite3_open_v2() reports unknown names
+    return;
+  }
+
+  if (rc != SQLITE_OK) {
+    stop("Could not register VFS %s: %s", vfs, sqlite3_errstr(rc));
+  }
+}
 
-DbConnection::DbConnection(const std::string& path, const bool allow_ext, const int flags, const std::string& vfs, bool with_alt_types)
+DbConnection::DbConnection(const std::string& path, const bool allow_ext, const int flags, const std::string& vfs, bool with_alt_types,
+                           const std::string& bigint)
   : pConn_(NULL), 
+    path_(path),
+    flags_(flags),
+    vfs_(vfs),
     with_alt_types_(with_alt_types),
-    busy_callback_(NULL) {
+    bigint_(bigint),
+    busy_callback_(NULL),
+    background_(0),
+    data_frame_module_(false),
+    r_functions_(false),
+    statement_cache_size_(0),
+    use_reader_(false),
+    temp_objects_stmt_(NULL) {
+
+  counts_.hits = counts_.misses = counts_.reader_queries = 0;
+
+  prepare_vfs(vfs);
 
   // Get the underlying database connection
   int rc = sqlite3_open_v2(path.c_str(), &pConn_, flags, vfs.empty() ? NULL : vfs.c_str());
@@ -15,6 +86,8 @@ DbConnection::DbConnection(const std::string& path, const bool allow_ext, const
   if (allow_ext) {
     sqlite3_enable_load_extension(pConn_, 1);
   }
+  SqliteArray::register_module(pConn_);
+  sqlite3_rollback_hook(pConn_, rollback_callback, this);
 }
 
 DbConnection::~DbConnection() {
@@ -23,6 +96,8 @@ DbConnection::~DbConnection() {
   }
   // in case this is still lingering for an invalid connection
   release_callback_data();
+  data_frames_.clear();
+  release_deserialized();
 }
 
 sqlite3* DbConnection::conn() const {
@@ -57,21 +132,12 @@ std::string DbConnection::getException() const {
     return std::string();
 }
 
-void DbConnection::copy_to(const DbConnectionPtr& pDest) {
-  sqlite3_backup* backup =
-    sqlite3_backup_init(pDest->conn(), "main", pConn_, "main");
-
-  int rc = sqlite3_backup_step(backup, -1);
-  if (rc != SQLITE_DONE) {
-    stop("Failed to copy all data:\n%s", getException());
-  }
-  rc = sqlite3_backup_finish(backup);
-  if (rc != SQLITE_OK) {
-    stop("Could not finish copy:\n%s", getException());
-  }
-}
-
 void DbConnection::disconnect() {
+  clear_statement_cache();
+  schema_cache_.clear();
+  if (reader_ && reader_->is_valid()) {
+    reader_->disconnect();
+  }
   sqlite3_close_v2(pConn_);
   pConn_ = NULL;
   release_callback_data();
@@ -81,8 +147,15 @@ bool DbConnection::with_alt_types() const {
   return with_alt_types_;
 }
 
+const std::string& DbConnection::bigint() const {
+  return bigint_;
+}
+
 void DbConnection::set_busy_handler(SEXP r_callback) {
   check_connection();
+  if (background_ > 0 && !Rf_isNull(r_callback) && !Rf_isInteger(r_callback)) {
+    stop("Cannot set an R busy handler while a background backup uses the connection");
+  }
   release_callback_data();
 
   if (! Rf_isNull(r_callback)) {
@@ -97,6 +170,503 @@ void DbConnection::set_busy_handler(SEXP r_callback) {
   }
 }
 
+bool DbConnection::has_r_busy_handler() const {
+  return busy_callback_ && !Rf_isInteger(busy_callback_);
+}
+
+void DbConnection::begin_background() {
+  ++background_;
+}
+
+void DbConnection::end_background() {
+  --background_;
+}
+
+void DbConnection::register_data_frame(const std::string& name, SEXP data,
+                                       const std::vector<std::string>& types,
+                                       const std::vector<std::string>& index) {
+  check_connection();
+
+  if (!data_frame_module_) {
+    int rc = SqliteVirtualDataFrame::register_module(pConn_, this);
+    if (rc != SQLITE_OK) {
+      stop("Could not register virtual table module:\n%s", getException());
+    }
+    data_frame_module_ = true;
+  }
+
+  if (data_frames_.count(name)) {
+    stop("A data frame is already registered as %s", name);
+  }
+
+  data_frames_[name] = SqliteVirtualDataFramePtr(new SqliteVirtualDataFrame(data, types, index));
+
+  char* sql = sqlite3_mprintf("CREATE VIRTUAL TABLE temp.\"%w\" USING rdataframe", name.c_str());
+  int rc = sqlite3_exec(pConn_, sql, NULL, NULL, NULL);
+  sqlite3_free(sql);
+  if (rc != SQLITE_OK) {
+    data_frames_.erase(name);
+    stop("Could not register data frame:\n%s", getException());
+  }
+}
+
+void DbConnection::unregister_data_frame(const std::string& name) {
+  check_connection();
+
+  if (!data_frames_.count(name)) {
+    stop("No data frame is registered as %s", name);
+  }
+
+  char* sql = sqlite3_mprintf("DROP TABLE IF EXISTS temp.\"%w\"", name.c_str());
+  int rc = sqlite3_exec(pConn_, sql, NULL, NULL, NULL);
+  sqlite3_free(sql);
+  if (rc != SQLITE_OK) {
+    stop("Could not unregister data frame:\n%s", getException());
+  }
+
+  data_frames_.erase(name);
+}
+
+SqliteVirtualDataFramePtr DbConnection::find_data_frame(const std::string& name) const {
+  std::map<std::string, SqliteVirtualDataFramePtr>::const_iterator it = data_frames_.find(name);
+  if (it == data_frames_.end()) return SqliteVirtualDataFramePtr();
+  return it->second;
+}
+
+RawVector DbConnection::serialize(const std::string& schema) const {
+  check_connection();
+
+  // Only databases held by the memdb VFS, i.e. deserialized ones, can be read
+  // in place; ordinary :memory: databases and files are serialized below
+  sqlite3_int64 size = 0;
+  unsigned char* data = sqlite3_serialize(pConn_, schema.c_str(), &size, SQLITE_SERIALIZE_NOCOPY);
+  if (data != NULL) {
+    RawVector out(static_cast<R_xlen_t>(size));
+    memcpy(RAW(out), data, static_cast<size_t>(size));
+    return out;
+  }
+
+  size = 0;
+  data = sqlite3_serialize(pConn_, schema.c_str(), &size, 0);
+  if (data == NULL) {
+    if (size == 0) return RawVector(0);
+    stop("Could not serialize schema %s:\n%s", schema, getException());
+  }
+
+  RawVector out(static_cast<R_xlen_t>(size));
+  memcpy(RAW(out), data, static_cast<size_t>(size));
+  sqlite3_free(data);
+  return out;
+}
+
+void DbConnection::deserialize(const std::string& schema, SEXP data, bool read_only) {
+  check_connection();
+  if (TYPEOF(data) != RAWSXP) stop("Can only deserialize raw vectors");
+
+  const sqlite3_int64 size = Rf_xlength(data);
+  unsigned char* buffer;
+  unsigned int flags;
+
+  if (read_only) {
+    // Used in place, must stay alive and unchanged as long as the schema:
+    // R copies the vector before modifying it from now on
+    MARK_NOT_MUTABLE(data);
+    buffer = RAW(data);
+    flags = SQLITE_DESERIALIZE_READONLY;
+  }
+  else {
+    buffer = static_cast<unsigned char*>(sqlite3_malloc64(size > 0 ? size : 1));
+    if (buffer == NULL) stop("Could not allocate %.0f bytes", static_cast<double>(size));
+    memcpy(buffer, RAW(data), static_cast<size_t>(size));
+    flags = SQLITE_DESERIALIZE_FREEONCLOSE | SQLITE_DESERIALIZE_RESIZEABLE;
+  }
+
+  // Frees buffer also on failure if SQLITE_DESERIALIZE_FREEONCLOSE is set
+  int rc = sqlite3_deserialize(pConn_, schema.c_str(), buffer, size, size, flags);
+  if (rc != SQLITE_OK) {
+    stop("Could not deserialize into schema %s:\n%s", schema, getException());
+  }
+  // The schema version of the new database may equal the old one
+  schema_cache_.invalidate();
+
+  // The previous database of the schema is closed
+  std::map<std::string, SEXP>::iterator it = deserialized_.find(schema);
+  if (it != deserialized_.end()) {
+    R_ReleaseObject(it->second);
+    deserialized_.erase(it);
+  }
+  if (read_only) {
+    R_PreserveObject(data);
+    deserialized_[schema] = data;
+  }
+}
+
+List DbConnection::vfs_stats(const std::string& schema, bool reset) const {
+  check_connection();
+
+  RSQLite_io_stats stats;
+  int rc = sqlite3_file_control(pConn_, schema.c_str(), RSQLITE_FCNTL_VFS_STATS, &stats);
+  if (rc == SQLITE_NOTFOUND) {
+    stop("No I/O statistics for schema %s, connect with the \"stats\" VFS", schema);
+  }
+  if (rc != SQLITE_OK) {
+    stop("Could not query I/O statistics for schema %s:\n%s", schema, sqlite3_errstr(rc));
+  }
+  if (reset) {
+    sqlite3_file_control(pConn_, schema.c_str(), RSQLITE_FCNTL_VFS_STATS_RESET, NULL);
+  }
+
+  const int n = RSQLITE_IO_NTYPE;
+  NumericVector opens(n), reads(n), read_bytes(n), writes(n), write_bytes(n),
+    syncs(n), truncates(n), locks(n), lock_busy(n), unlocks(n), shm_locks(n),
+    read_time(n), write_time(n), sync_time(n), lock_time(n);
+  NumericVector latency(n * RSQLITE_IO_NOP * RSQLITE_IO_NBUCKET);
+
+  for (int i = 0; i < n; ++i) {
+    const RSQLite_io_counts& c = stats.aType[i];
+    opens[i] = static_cast<double>(c.nOpen);
+    reads[i] = static_cast<double>(c.nRead);
+    read_bytes[i] = static_cast<double>(c.nReadBytes);
+    writes[i] = static_cast<double>(c.nWrite);
+    write_bytes[i] = static_cast<double>(c.nWriteBytes);
+    syncs[i] = static_cast<double>(c.nSync);
+    truncates[i] = static_cast<double>(c.nTruncate);
+    locks[i] = static_cast<double>(c.nLock);
+    lock_busy[i] = static_cast<double>(c.nLockBusy);
+    unlocks[i] = static_cast<double>(c.nUnlock);
+    shm_locks[i] = static_cast<double>(c.nShmLock);
+    read_time[i] = c.aTime[RSQLITE_IO_READ] / 1e6;
+    write_time[i] = c.aTime[RSQLITE_IO_WRITE] / 1e6;
+    sync_time[i] = c.aTime[RSQLITE_IO_SYNC] / 1e6;
+    lock_time[i] = c.aTime[RSQLITE_IO_LOCK] / 1e6;
+
+    // Buckets vary fastest, then operations, then file types
+    for (int op = 0; op < RSQLITE_IO_NOP; ++op) {
+      for (int b = 0; b < RSQLITE_IO_NBUCKET; ++b) {
+        latency[(i * RSQLITE_IO_NOP + op) * RSQLITE_IO_NBUCKET + b] =
+          static_cast<double>(c.aHist[op][b]);
+      }
+    }
+  }
+
+  List counts = List::create(
+    _["opens"] = opens, _["reads"] = reads, _["read_bytes"] = read_bytes,
+    _["writes"] = writes, _["write_bytes"] = write_bytes, _["syncs"] = syncs,
+    _["truncates"] = truncates, _["locks"] = locks, _["lock_busy"] = lock_busy,
+    _["unlocks"] = unlocks, _["shm_locks"] = shm_locks,
+    _["read_time"] = read_time, _["write_time"] = write_time,
+    _["sync_time"] = sync_time, _["lock_time"] = lock_time
+  );
+  return List::create(_["counts"] = counts, _["latency"] = latency);
+}
+
+void DbConnection::create_function(const std::string& name, SEXP fun, int n_arg,
+                                   bool aggregate, bool deterministic, int cache_size) {
+  check_connection();
+
+  int rc = SqliteRFunction::create(pConn_, name, fun, n_arg, aggregate, deterministic, cache_size);
+  if (rc != SQLITE_OK) {
+    stop("Could not create function %s:\n%s", name, getException());
+  }
+  r_functions_ = true;
+  functions_[function_key(name)].insert(n_arg);
+  // The function may override a built-in function that the reader would use
+  use_reader_ = false;
+}
+
+void DbConnection::remove_function(const std::string& name, int n_arg) {
+  check_connection();
+
+  std::set<int> n_args;
+  std::map<std::string, std::set<int> >::iterator it = functions_.find(function_key(name));
+  if (n_arg != NA_INTEGER) {
+    n_args.insert(n_arg);
+  } else if (it != functions_.end()) {
+    n_args = it->second;
+  } else {
+    stop("No function %s was created for this connection", name);
+  }
+
+  for (std::set<int>::const_iterator n = n_args.begin(); n != n_args.end(); ++n) {
+    int rc = sqlite3_create_function_v2(pConn_, name.c_str(), *n, SQLITE_UTF8,
+                                        NULL, NULL, NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+      stop("Could not remove function %s:\n%s", name, getException());
+    }
+    if (it != functions_.end()) it->second.erase(*n);
+  }
+  if (it != functions_.end() && it->second.empty()) functions_.erase(it);
+}
+
+// SQL function names are case-insensitive
+std::string DbConnection::function_key(const std::string& name) {
+  std::string key = name;
+  for (size_t i = 0; i < key.size(); ++i) {
+    key[i] = static_cast<char>(tolower(static_cast<unsigned char>(key[i])));
+  }
+  return key;
+}
+
+std::vector<std::string> DbConnection::list_tables() {
+  check_connection();
+  return schema_cache_.list_tables(pConn_);
+}
+
+bool DbConnection::exists_table(const std::string& schema, const std::string& name) {
+  check_connection();
+  return schema_cache_.exists_table(pConn_, schema, name);
+}
+
+std::vector<std::string> DbConnection::list_fields(const std::string& schema,
+                                                   const std::string& name) {
+  check_connection();
+  return schema_cache_.list_fields(pConn_, schema, name);
+}
+
+void DbConnection::invalidate_schema_cache() {
+  schema_cache_.invalidate();
+}
+
+void DbConnection::rollback_callback(void* data) {
+  static_cast<DbConnection*>(data)->schema_cache_.invalidate();
+}
+
+void DbConnection::init_extension(const std::string& name) {
+  check_connection();
+
+  extension_init_fun init = find_extension(name);
+  char* zErrMsg = NULL;
+  int rc = init(pConn_, &zErrMsg, NULL);
+  if (rc != SQLITE_OK) {
+    std::string err_msg = zErrMsg ? zErrMsg : sqlite3_errstr(rc);
+    sqlite3_free(zErrMsg);
+    stop("Failed to initialize extension: %s", err_msg.c_str());
+  }
+
+  if (std::find(extensions_.begin(), extensions_.end(), name) == extensions_.end()) {
+    extensions_.push_back(name);
+  }
+  if (reader_ && reader_->is_valid()) {
+    reader_->init_extension(name);
+  }
+}
+
+void DbConnection::set_statement_cache_size(int n) {
+  statement_cache_size_ = std::max(n, 0);
+  while (statements_.size() > static_cast<size_t>(statement_cache_size_)) {
+    sqlite3_finalize(statements_.front().stmt);
+    statements_.pop_front();
+  }
+  if (reader_) {
+    reader_->set_statement_cache_size(n);
+  }
+}
+
+sqlite3_stmt* DbConnection::take_statement(const std::string& sql, int& generation) {
+  generation = -1;
+  if (statement_cache_size_ == 0) return NULL;
+
+  // Column names and counts are read when a statement is prepared, a
+  // statement prepared for an older schema is only updated by its next step.
+  // The schemas of attached databases are not tracked.
+  if (sqlite3_db_name(pConn_, 2) == NULL) {
+    generation = schema_cache_.generation(pConn_);
+  }
+
+  sqlite3_stmt* stmt = NULL;
+  std::list<cached_statement>::iterator it = statements_.begin();
+  while (it != statements_.end()) {
+    if (generation < 0 || it->generation != generation) {
+      sqlite3_finalize(it->stmt);
+      it = statements_.erase(it);
+    }
+    else if (it->sql == sql) {
+      // Most recently used last, and unique
+      stmt = it->stmt;
+      it = statements_.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  if (stmt != NULL) {
+    counts_.hits++;
+  } else {
+    counts_.misses++;
+  }
+  return stmt;
+}
+
+void DbConnection::release_statement(const std::string& sql, sqlite3_stmt* stmt, int generation) {
+  if (stmt == NULL) return;
+
+  if (!is_valid() || statement_cache_size_ == 0 || generation < 0) {
+    sqlite3_finalize(stmt);
+    return;
+  }
+
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+  cached_statement entry = { sql, stmt, generation };
+  statements_.push_back(entry);
+  if (statements_.size() > static_cast<size_t>(statement_cache_size_)) {
+    sqlite3_finalize(statements_.front().stmt);
+    statements_.pop_front();
+  }
+}
+
+void DbConnection::clear_statement_cache() {
+  std::list<cached_statement>::iterator it = statements_.begin();
+  for (; it != statements_.end(); ++it) {
+    sqlite3_finalize(it->stmt);
+  }
+  statements_.clear();
+
+  sqlite3_finalize(temp_objects_stmt_);
+  temp_objects_stmt_ = NULL;
+}
+
+static int first_column_callback(void* data, int, char** values, char**) {
+  if (values[0] != NULL) *static_cast<std::string*>(data) = values[0];
+  return 0;
+}
+
+bool DbConnection::enable_reader() {
+  check_connection();
+
+  std::string mode;
+  int rc = sqlite3_exec(pConn_, "PRAGMA journal_mode=WAL", first_column_callback, &mode, NULL);
+  use_reader_ = (rc == SQLITE_OK && mode == "wal");
+  return use_reader_;
+}
+
+// SELECT, WITH or VALUES, the other read-only statements include BEGIN,
+// ATTACH and PRAGMA, which must run on the connection itself
+static bool is_query(const char* sql) {
+  while (isspace(*sql)) ++sql;
+  static const char* const keywords[] = { "select", "with", "values" };
+  for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); ++i) {
+    const int n = static_cast<int>(strlen(keywords[i]));
+    if (sqlite3_strnicmp(sql, keywords[i], n) == 0 && !isalnum(sql[n]) && sql[n] != '_') {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Temporary tables and views would be shadowed by tables of the same name
+// on the reader
+bool DbConnection::has_temp_objects() {
+  if (temp_objects_stmt_ == NULL) {
+    int rc = sqlite3_prepare_v2(pConn_, "SELECT 1 FROM temp.sqlite_master LIMIT 1", -1,
+                                &temp_objects_stmt_, NULL);
+    if (rc != SQLITE_OK) return true;
+  }
+  int rc = sqlite3_step(temp_objects_stmt_);
+  sqlite3_reset(temp_objects_stmt_);
+  return rc != SQLITE_DONE;
+}
+
+DbConnection* DbConnection::route(const std::string& sql, sqlite3_stmt*& stmt, int& generation) {
+  // Queries in a transaction must see its changes
+  if (!use_reader_ || !is_valid() || !sqlite3_get_autocommit(pConn_)) return this;
+  if (!sqlite3_stmt_readonly(stmt) || !is_query(sqlite3_sql(stmt))) return this;
+  if (has_temp_objects()) return this;
+
+  if (!reader_) {
+    try {
+      const int flags = (flags_ & ~(SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE)) | SQLITE_OPEN_READONLY;
+      reader_.reset(new DbConnection(path_, false, flags, vfs_, with_alt_types_, bigint_));
+      reader_->set_statement_cache_size(statement_cache_size_);
+      for (size_t i = 0; i < extensions_.size(); ++i) {
+        reader_->init_extension(extensions_[i]);
+      }
+    } catch (...) {
+      reader_.reset();
+      use_reader_ = false;
+      return this;
+    }
+  }
+  if (!reader_->is_valid()) return this;
+
+  // Fails for objects that exist only on this connection, such as functions
+  int reader_generation = -1;
+  sqlite3_stmt* reader_stmt = reader_->take_statement(sql, reader_generation);
+  if (reader_stmt == NULL) {
+    int rc = sqlite3_prepare_v2(reader_->pConn_, sql.c_str(), -1, &reader_stmt, NULL);
+    if (rc != SQLITE_OK) {
+      sqlite3_finalize(reader_stmt);
+      return this;
+    }
+  }
+
+  release_statement(sql, stmt, generation);
+  stmt = reader_stmt;
+  generation = reader_generation;
+  counts_.reader_queries++;
+  return reader_.get();
+}
+
+bool DbConnection::is_reusable() const {
+  if (!is_valid() || !sqlite3_get_autocommit(pConn_)) return false;
+
+  sqlite3_stmt* stmt = sqlite3_next_stmt(pConn_, NULL);
+  for (; stmt != NULL; stmt = sqlite3_next_stmt(pConn_, stmt)) {
+    if (sqlite3_stmt_busy(stmt)) return false;
+  }
+
+  // The file was deleted or renamed
+  int moved = 0;
+  if (sqlite3_file_control(pConn_, "main", SQLITE_FCNTL_HAS_MOVED, &moved) == SQLITE_OK && moved) {
+    return false;
+  }
+
+  return true;
+}
+
+bool DbConnection::reset_for_reuse() {
+  if (!is_valid()) return false;
+  if (r_functions_ || !data_frames_.empty() || !deserialized_.empty()) return false;
+
+  if (!sqlite3_get_autocommit(pConn_)) {
+    sqlite3_exec(pConn_, "ROLLBACK", NULL, NULL, NULL);
+  }
+  if (busy_callback_) {
+    sqlite3_busy_handler(pConn_, NULL, NULL);
+    release_callback_data();
+  }
+
+  return is_reusable();
+}
+
+const std::string& DbConnection::pool_key() const {
+  return pool_key_;
+}
+
+void DbConnection::set_pool_key(const std::string& key) {
+  pool_key_ = key;
+}
+
+DbConnection::statement_counts DbConnection::take_statement_counts() {
+  statement_counts ret = counts_;
+  if (reader_) {
+    statement_counts reader = reader_->take_statement_counts();
+    ret.hits += reader.hits;
+    ret.misses += reader.misses;
+  }
+  counts_.hits = counts_.misses = counts_.reader_queries = 0;
+  return ret;
+}
+
+void DbConnection::release_deserialized() {
+  std::map<std::string, SEXP>::iterator it = deserialized_.begin();
+  for (; it != deserialized_.end(); ++it) {
+    R_ReleaseObject(it->second);
+  }
+  deserialized_.clear();
+}
+
 void DbConnection::release_callback_data() {
   if (busy_callback_) {
     R_ReleaseObject(busy_callback_);
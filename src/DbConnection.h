@@ -3,7 +3,12 @@
 
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
+#include <list>
+#include <map>
+#include <set>
 #include "sqlite3-cpp.h"
+#include "SqliteSchemaCache.h"
+#include "SqliteVirtualDataFrame.h"
 
 class DbResult;
 
@@ -20,7 +25,8 @@ class DbConnection : boost::noncopyable {
 public:
   // Create a new connection handle
   DbConnection(const std::string& path, bool allow_ext,
-               int flags, const std::string& vfs = "", bool with_alt_types = false);
+               int flags, const std::string& vfs = "", bool with_alt_types = false,
+               const std::string& bigint = "integer64");
   ~DbConnection();
 
 public:
@@ -41,22 +47,122 @@ public:
   // Get the last exception as a string
   std::string getException() const;
 
-  // Copies a database
-  void copy_to(const DbConnectionPtr& pDest);
-
   // Disconnects from a database
   void disconnect();
 
   bool with_alt_types() const;
 
+  // The R type of 64-bit integers, as in dbConnect()
+  const std::string& bigint() const;
+
   void set_busy_handler(SEXP r_callback);
+  // Busy handlers written in R must not run outside the main thread
+  bool has_r_busy_handler() const;
+
+  // Background threads that use the connection, see DbBackup
+  void begin_background();
+  void end_background();
+
+  // Data frames exposed as virtual tables in the temp schema
+  void register_data_frame(const std::string& name, SEXP data,
+                           const std::vector<std::string>& types,
+                           const std::vector<std::string>& index);
+  void unregister_data_frame(const std::string& name);
+  SqliteVirtualDataFramePtr find_data_frame(const std::string& name) const;
+
+  // Copies a schema into a raw vector
+  RawVector serialize(const std::string& schema) const;
+
+  // Replaces a schema by the database in a raw vector; a read-only database
+  // uses the raw vector without copying it
+  void deserialize(const std::string& schema, SEXP data, bool read_only);
+
+  // Counters of the "stats" VFS shim for a schema, optionally resets them
+  List vfs_stats(const std::string& schema, bool reset) const;
+
+  // R functions called from SQL, n_arg is -1 for any number of arguments
+  void create_function(const std::string& name, SEXP fun, int n_arg, bool aggregate,
+                       bool deterministic, int cache_size);
+  // n_arg is NA_INTEGER to remove all numbers of arguments the function was
+  // created with
+  void remove_function(const std::string& name, int n_arg);
+
+  // Tables and views of the main and temp schemas, from the schema cache
+  std::vector<std::string> list_tables();
+  bool exists_table(const std::string& schema, const std::string& name);
+  std::vector<std::string> list_fields(const std::string& schema, const std::string& name);
+  // After ROLLBACK TO, which restores an earlier schema version
+  void invalidate_schema_cache();
+
+  // Registers an extension compiled into the package, also on the reader
+  void init_extension(const std::string& name);
+
+  // Prepared statements kept for reuse, up to n of them
+  void set_statement_cache_size(int n);
+  // A cached statement for sql, or NULL.  generation identifies the schema
+  // that the statement is prepared for, it is passed back on release.
+  sqlite3_stmt* take_statement(const std::string& sql, int& generation);
+  // Resets the statement and caches it, or finalizes it
+  void release_statement(const std::string& sql, sqlite3_stmt* stmt, int generation);
+
+  // Runs read-only queries on a second, read-only connection, switches the
+  // database to WAL mode; returns false for databases without WAL
+  bool enable_reader();
+  // Moves a prepared read-only query to the reader if possible, returns the
+  // connection that owns the statement
+  DbConnection* route(const std::string& sql, sqlite3_stmt*& stmt, int& generation);
+
+  // Can the connection be handed out again by the pool?
+  bool is_reusable() const;
+  // Rolls back open transactions and removes the busy handler; returns false
+  // if the connection holds R objects and cannot be reused
+  bool reset_for_reuse();
+
+  // Key of the connection pool that the connection returns to, or empty
+  const std::string& pool_key() const;
+  void set_pool_key(const std::string& key);
+
+  struct statement_counts {
+    int hits, misses, reader_queries;
+  };
+  // Counts since the last call
+  statement_counts take_statement_counts();
 
 private:
   sqlite3* pConn_;
+  const std::string path_;
+  const int flags_;
+  const std::string vfs_;
   const bool with_alt_types_;
+  const std::string bigint_;
   SEXP busy_callback_;
+  int background_;
+  bool data_frame_module_;
+  bool r_functions_;
+  std::map<std::string, std::set<int> > functions_;
+  std::map<std::string, SqliteVirtualDataFramePtr> data_frames_;
+  std::map<std::string, SEXP> deserialized_;
+  std::vector<std::string> extensions_;
+  struct cached_statement {
+    std::string sql;
+    sqlite3_stmt* stmt;
+    int generation;
+  };
+  std::list<cached_statement> statements_;
+  int statement_cache_size_;
+  statement_counts counts_;
+  bool use_reader_;
+  DbConnectionPtr reader_;
+  sqlite3_stmt* temp_objects_stmt_;
+  SqliteSchemaCache schema_cache_;
+  std::string pool_key_;
+  void release_deserialized();
   void release_callback_data();
+  void clear_statement_cache();
+  bool has_temp_objects();
   static int busy_callback_helper(void *data, int num);
+  static void rollback_callback(void* data);
+  static std::string function_key(const std::string& name);
 };
 
 #endif // __RSQLITE_SQLITE_CONNECTION__
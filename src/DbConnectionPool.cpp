@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "DbConnectionPool.h"
+#include <algorithm>
+#include <cstring>
+
+
+// Construction ////////////////////////////////////////////////////////////////
+
+DbConnectionPool::DbConnectionPool() :
+  max_idle_(4),
+  statement_cache_(32),
+  readers_(false)
+{
+  memset(&counts_, 0, sizeof(counts_));
+}
+
+DbConnectionPool& DbConnectionPool::instance() {
+  static DbConnectionPool pool;
+  return pool;
+}
+
+
+// Publics /////////////////////////////////////////////////////////////////////
+
+DbConnectionPtr DbConnectionPool::checkout(const std::string& key) {
+  counts_.checkouts++;
+
+  idle_map::iterator it = idle_.find(key);
+  if (it != idle_.end()) {
+    // Most recently returned first, its cache is the warmest
+    while (!it->second.empty()) {
+      DbConnectionPtr conn = it->second.back();
+      it->second.pop_back();
+      if (conn->is_reusable()) {
+        counts_.reused++;
+        return conn;
+      }
+      counts_.invalid++;
+      close(conn);
+    }
+    idle_.erase(it);
+  }
+
+  counts_.created++;
+  return DbConnectionPtr();
+}
+
+void DbConnectionPool::adopt(const DbConnectionPtr& conn, const std::string& key) {
+  conn->set_statement_cache_size(statement_cache_);
+  if (readers_) {
+    conn->enable_reader();
+  }
+  conn->set_pool_key(key);
+}
+
+bool DbConnectionPool::checkin(const DbConnectionPtr& conn) {
+  const std::string& key = conn->pool_key();
+  if (key.empty()) return false;
+
+  std::deque<DbConnectionPtr>& idle = idle_[key];
+  if (idle.size() >= static_cast<size_t>(max_idle_) || !conn->reset_for_reuse()) {
+    counts_.discarded++;
+    close(conn);
+    return false;
+  }
+
+  collect(conn);
+  counts_.returned++;
+  idle.push_back(conn);
+  return true;
+}
+
+void DbConnectionPool::configure(int max_idle, int statement_cache, bool readers) {
+  max_idle_ = std::max(max_idle, 0);
+  statement_cache_ = std::max(statement_cache, 0);
+  readers_ = readers;
+}
+
+List DbConnectionPool::get_config() const {
+  return List::create(
+    _["max_idle"] = max_idle_,
+    _["statement_cache"] = statement_cache_,
+    _["readers"] = readers_
+  );
+}
+
+List DbConnectionPool::get_stats(bool reset) {
+  double idle = 0;
+  for (idle_map::const_iterator it = idle_.begin(); it != idle_.end(); ++it) {
+    idle += it->second.size();
+  }
+
+  List ret = List::create(
+    _["idle"] = idle,
+    _["checkouts"] = counts_.checkouts,
+    _["reused"] = counts_.reused,
+    _["created"] = counts_.created,
+    _["invalid"] = counts_.invalid,
+    _["returned"] = counts_.returned,
+    _["discarded"] = counts_.discarded,
+    _["statement_hits"] = counts_.statement_hits,
+    _["statement_misses"] = counts_.statement_misses,
+    _["reader_queries"] = counts_.reader_queries
+  );
+
+  if (reset) {
+    memset(&counts_, 0, sizeof(counts_));
+  }
+  return ret;
+}
+
+void DbConnectionPool::clear() {
+  for (idle_map::iterator it = idle_.begin(); it != idle_.end(); ++it) {
+    for (size_t i = 0; i < it->second.size(); ++i) {
+      close(it->second[i]);
+    }
+  }
+  idle_.clear();
+}
+
+
+// Privates ////////////////////////////////////////////////////////////////////
+
+void DbConnectionPool::collect(const DbConnectionPtr& conn) {
+  DbConnection::statement_counts stmt_counts = conn->take_statement_counts();
+  counts_.statement_hits += stmt_counts.hits;
+  counts_.statement_misses += stmt_counts.misses;
+  counts_.reader_queries += stmt_counts.reader_queries;
+}
+
+void DbConnectionPool::close(const DbConnectionPtr& conn) {
+  collect(conn);
+  if (conn->is_valid()) {
+    conn->disconnect();
+  }
+}
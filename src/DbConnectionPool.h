@@ -0,0 +1,58 @@
+#ifndef __RSQLITE_DB_CONNECTION_POOL__
+#define __RSQLITE_DB_CONNECTION_POOL__
+
+#include <boost/noncopyable.hpp>
+#include <deque>
+#include <map>
+#include "DbConnection.h"
+
+// Connection pool -------------------------------------------------------------
+
+// Idle connections, keyed by everything that was used to open and configure
+// them: database path, flags, VFS, and the settings made by dbConnect().
+// Connections keep their page cache and their prepared statements while they
+// are idle.  They are validated when they are handed out again, connections
+// that fail are closed.
+
+class DbConnectionPool : boost::noncopyable {
+public:
+  static DbConnectionPool& instance();
+
+public:
+  // An idle connection for the key, or an empty pointer
+  DbConnectionPtr checkout(const std::string& key);
+
+  // Prepares a new connection for the pool: sets the size of its statement
+  // cache and its reader, and the key it returns to
+  void adopt(const DbConnectionPtr& conn, const std::string& key);
+
+  // Takes back a connection; returns false if it is closed instead
+  bool checkin(const DbConnectionPtr& conn);
+
+  void configure(int max_idle, int statement_cache, bool readers);
+  List get_config() const;
+  List get_stats(bool reset);
+
+  // Closes all idle connections
+  void clear();
+
+private:
+  DbConnectionPool();
+  // Adds the statement counts of a connection
+  void collect(const DbConnectionPtr& conn);
+  void close(const DbConnectionPtr& conn);
+
+  typedef std::map<std::string, std::deque<DbConnectionPtr> > idle_map;
+  idle_map idle_;
+
+  int max_idle_;
+  int statement_cache_;
+  bool readers_;
+
+  struct counts {
+    double checkouts, reused, created, invalid, returned, discarded;
+    double statement_hits, statement_misses, reader_queries;
+  } counts_;
+};
+
+#endif // __RSQLITE_DB_CONNECTION_POOL__
@@ -8,7 +8,8 @@
 #include <boost/range/algorithm_ext/for_each.hpp>
 
 DbDataFrame::DbDataFrame(DbColumnDataSourceFactory* factory_, std::vector<std::string> names_, const int n_max_,
-                         const std::vector<DATA_TYPE>& types_)
+                         const std::vector<DATA_TYPE>& types_, const std::vector<DATA_TYPE>& fixed_types_,
+                         DATA_TYPE bigint_)
   : n_max(n_max_),
     i(0),
     names(names_)
@@ -17,7 +18,9 @@ DbDataFrame::DbDataFrame(DbColumnDataSourceFactory* factory_, std::vector<std::s
 
   data.reserve(types_.size());
   for (size_t j = 0; j < types_.size(); ++j) {
-    DbColumn x(types_[j], n_max, factory.get(), (int)j);
+    // DT_UNKNOWN: the type is guessed from the data
+    const bool fixed = (fixed_types_[j] != DT_UNKNOWN);
+    DbColumn x(fixed ? fixed_types_[j] : types_[j], n_max, factory.get(), (int)j, fixed, bigint_);
     data.push_back(x);
   }
 }
@@ -64,6 +67,62 @@ List DbDataFrame::get_data(std::vector<DATA_TYPE>& types_) {
   return out;
 }
 
+void DbDataFrame::reset() {
+  i = 0;
+  std::for_each(data.begin(), data.end(), boost::bind(&DbColumn::reset, _1, n_max));
+}
+
+SEXP DbDataFrame::get_chunk(std::vector<DATA_TYPE>& types_, SEXP previous) {
+  finalize_cols();
+
+  std::vector<DATA_TYPE> new_types;
+  std::transform(data.begin(), data.end(), std::back_inserter(new_types), boost::mem_fn(&DbColumn::get_type));
+
+  boost::for_each(data, names, boost::bind(&DbColumn::warn_type_conflicts, _1, _2));
+
+  // Not using Rcpp classes here, they would hold references to the vectors
+  const R_xlen_t ncols = static_cast<R_xlen_t>(data.size());
+  const bool reuse = !Rf_isNull(previous) && !MAYBE_REFERENCED(previous) &&
+    Rf_xlength(previous) == ncols && types_.size() == data.size();
+
+  SEXP out = previous;
+  if (!reuse) {
+    out = PROTECT(Rf_allocVector(VECSXP, ncols));
+
+    // Empty names as in tidy_names()
+    SEXP names_utf8 = PROTECT(Rf_allocVector(STRSXP, ncols));
+    for (R_xlen_t j = 0; j < ncols; ++j) {
+      std::string name = names[j];
+      if (name.empty()) {
+        std::stringstream ss;
+        ss << ".." << (j + 1);
+        name = ss.str();
+      }
+      SET_STRING_ELT(names_utf8, j, Rf_mkCharCE(name.c_str(), CE_UTF8));
+    }
+    Rf_setAttrib(out, R_NamesSymbol, names_utf8);
+    Rf_setAttrib(out, R_ClassSymbol, Rf_mkString("data.frame"));
+    UNPROTECT(1);
+  }
+  else {
+    PROTECT(out);
+  }
+
+  for (R_xlen_t j = 0; j < ncols; ++j) {
+    SEXP x = (reuse && types_[j] == new_types[j]) ? VECTOR_ELT(out, j) : R_NilValue;
+    SET_VECTOR_ELT(out, j, data[j].get_data(x));
+  }
+
+  SEXP row_names = PROTECT(Rf_allocVector(INTSXP, 2));
+  INTEGER(row_names)[0] = NA_INTEGER;
+  INTEGER(row_names)[1] = -i;
+  Rf_setAttrib(out, R_RowNamesSymbol, row_names);
+
+  UNPROTECT(2);
+  types_ = new_types;
+  return out;
+}
+
 size_t DbDataFrame::get_ncols() const {
   return data.size();
 }
@@ -19,7 +19,9 @@ public:
   DbDataFrame(DbColumnDataSourceFactory* factory,
               std::vector<std::string> names,
               const int n_max_,
-              const std::vector<DATA_TYPE>& types);
+              const std::vector<DATA_TYPE>& types,
+              const std::vector<DATA_TYPE>& fixed_types,
+              DATA_TYPE bigint = DT_INT64);
   virtual ~DbDataFrame();
 
 public:
@@ -28,6 +30,13 @@ public:
 
   List get_data();
   List get_data(std::vector<DATA_TYPE>& types);
+
+  // For fetching in chunks: reset() starts a new chunk with the same
+  // column buffers, get_chunk() fills the vectors of previous if nothing
+  // else refers to them
+  void reset();
+  SEXP get_chunk(std::vector<DATA_TYPE>& types, SEXP previous);
+
   size_t get_ncols() const;
 
 private:
@@ -56,6 +56,13 @@ List DbResult::fetch(const int n_max) {
   return impl->fetch(n_max);
 }
 
+int DbResult::fetch_chunks(const int n, SEXP callback) {
+  if (!is_active())
+    stop("Inactive result set");
+
+  return impl->fetch_chunks(n, callback);
+}
+
 List DbResult::get_column_info() {
   List out = impl->get_column_info();
 
@@ -35,6 +35,7 @@ public:
 
   void bind(const List& params);
   List fetch(int n_max = -1);
+  int fetch_chunks(int n, SEXP callback);
 
   List get_column_info();
 
@@ -6,6 +6,7 @@
 #include <RSQLite.h>
 
 #include "DbConnection.h"
+#include "DbBackup.h"
 #include "DbResult.h"
 #include "SqliteResult.h"
 
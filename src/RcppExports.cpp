@@ -11,9 +11,77 @@ Rcpp::Rostream<true>&  Rcpp::Rcout = Rcpp::Rcpp_cout_get();
 Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
+// backup_init
+XPtr<DbBackup> backup_init(const XPtr<DbConnectionPtr>& from, const XPtr<DbConnectionPtr>& to);
+RcppExport SEXP _RSQLite_backup_init(SEXP fromSEXP, SEXP toSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type from(fromSEXP);
+    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type to(toSEXP);
+    rcpp_result_gen = Rcpp::wrap(backup_init(from, to));
+    return rcpp_result_gen;
+END_RCPP
+}
+// backup_release
+void backup_release(XPtr<DbBackup> backup);
+RcppExport SEXP _RSQLite_backup_release(SEXP backupSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< XPtr<DbBackup> >::type backup(backupSEXP);
+    backup_release(backup);
+    return R_NilValue;
+END_RCPP
+}
+// backup_run
+void backup_run(XPtr<DbBackup> backup, const int pages, const int sleep_ms, SEXP progress);
+RcppExport SEXP _RSQLite_backup_run(SEXP backupSEXP, SEXP pagesSEXP, SEXP sleep_msSEXP, SEXP progressSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< XPtr<DbBackup> >::type backup(backupSEXP);
+    Rcpp::traits::input_parameter< const int >::type pages(pagesSEXP);
+    Rcpp::traits::input_parameter< const int >::type sleep_ms(sleep_msSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type progress(progressSEXP);
+    backup_run(backup, pages, sleep_ms, progress);
+    return R_NilValue;
+END_RCPP
+}
+// backup_start
+void backup_start(XPtr<DbBackup> backup, const int pages, const int sleep_ms);
+RcppExport SEXP _RSQLite_backup_start(SEXP backupSEXP, SEXP pagesSEXP, SEXP sleep_msSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< XPtr<DbBackup> >::type backup(backupSEXP);
+    Rcpp::traits::input_parameter< const int >::type pages(pagesSEXP);
+    Rcpp::traits::input_parameter< const int >::type sleep_ms(sleep_msSEXP);
+    backup_start(backup, pages, sleep_ms);
+    return R_NilValue;
+END_RCPP
+}
+// backup_progress
+List backup_progress(XPtr<DbBackup> backup);
+RcppExport SEXP _RSQLite_backup_progress(SEXP backupSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< XPtr<DbBackup> >::type backup(backupSEXP);
+    rcpp_result_gen = Rcpp::wrap(backup_progress(backup));
+    return rcpp_result_gen;
+END_RCPP
+}
+// backup_wait
+void backup_wait(XPtr<DbBackup> backup);
+RcppExport SEXP _RSQLite_backup_wait(SEXP backupSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< XPtr<DbBackup> >::type backup(backupSEXP);
+    backup_wait(backup);
+    return R_NilValue;
+END_RCPP
+}
 // connection_connect
-XPtr<DbConnectionPtr> connection_connect(const std::string& path, const bool allow_ext, const int flags, const std::string& vfs, bool with_alt_types);
-RcppExport SEXP _RSQLite_connection_connect(SEXP pathSEXP, SEXP allow_extSEXP, SEXP flagsSEXP, SEXP vfsSEXP, SEXP with_alt_typesSEXP) {
+XPtr<DbConnectionPtr> connection_connect(const std::string& path, const bool allow_ext, const int flags, const std::string& vfs, bool with_alt_types, const std::string& bigint);
+RcppExport SEXP _RSQLite_connection_connect(SEXP pathSEXP, SEXP allow_extSEXP, SEXP flagsSEXP, SEXP vfsSEXP, SEXP with_alt_typesSEXP, SEXP bigintSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -22,7 +90,8 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const int >::type flags(flagsSEXP);
     Rcpp::traits::input_parameter< const std::string& >::type vfs(vfsSEXP);
     Rcpp::traits::input_parameter< bool >::type with_alt_types(with_alt_typesSEXP);
-    rcpp_result_gen = Rcpp::wrap(connection_connect(path, allow_ext, flags, vfs, with_alt_types));
+    Rcpp::traits::input_parameter< const std::string& >::type bigint(bigintSEXP);
+    rcpp_result_gen = Rcpp::wrap(connection_connect(path, allow_ext, flags, vfs, with_alt_types, bigint));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -47,17 +116,6 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
-// connection_copy_database
-void connection_copy_database(const XPtr<DbConnectionPtr>& from, const XPtr<DbConnectionPtr>& to);
-RcppExport SEXP _RSQLite_connection_copy_database(SEXP fromSEXP, SEXP toSEXP) {
-BEGIN_RCPP
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type from(fromSEXP);
-    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type to(toSEXP);
-    connection_copy_database(from, to);
-    return R_NilValue;
-END_RCPP
-}
 // connection_import_file
 bool connection_import_file(const XPtr<DbConnectionPtr>& con, const std::string& name, const std::string& value, const std::string& sep, const std::string& eol, const int skip);
 RcppExport SEXP _RSQLite_connection_import_file(SEXP conSEXP, SEXP nameSEXP, SEXP valueSEXP, SEXP sepSEXP, SEXP eolSEXP, SEXP skipSEXP) {
@@ -85,15 +143,217 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
-// extension_load
-void extension_load(XPtr<DbConnectionPtr> con, const std::string& file, const std::string& entry_point);
-RcppExport SEXP _RSQLite_extension_load(SEXP conSEXP, SEXP fileSEXP, SEXP entry_pointSEXP) {
+// connection_register_data_frame
+void connection_register_data_frame(const XPtr<DbConnectionPtr>& con, const std::string& name, SEXP value, std::vector<std::string> types, std::vector<std::string> index);
+RcppExport SEXP _RSQLite_connection_register_data_frame(SEXP conSEXP, SEXP nameSEXP, SEXP valueSEXP, SEXP typesSEXP, SEXP indexSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type con(conSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type name(nameSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type value(valueSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type types(typesSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type index(indexSEXP);
+    connection_register_data_frame(con, name, value, types, index);
+    return R_NilValue;
+END_RCPP
+}
+// connection_unregister_data_frame
+void connection_unregister_data_frame(const XPtr<DbConnectionPtr>& con, const std::string& name);
+RcppExport SEXP _RSQLite_connection_unregister_data_frame(SEXP conSEXP, SEXP nameSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type con(conSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type name(nameSEXP);
+    connection_unregister_data_frame(con, name);
+    return R_NilValue;
+END_RCPP
+}
+// connection_serialize
+RawVector connection_serialize(const XPtr<DbConnectionPtr>& con, const std::string& schema);
+RcppExport SEXP _RSQLite_connection_serialize(SEXP conSEXP, SEXP schemaSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type con(conSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type schema(schemaSEXP);
+    rcpp_result_gen = Rcpp::wrap(connection_serialize(con, schema));
+    return rcpp_result_gen;
+END_RCPP
+}
+// connection_deserialize
+void connection_deserialize(const XPtr<DbConnectionPtr>& con, const std::string& schema, SEXP data, const bool read_only);
+RcppExport SEXP _RSQLite_connection_deserialize(SEXP conSEXP, SEXP schemaSEXP, SEXP dataSEXP, SEXP read_onlySEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type con(conSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type schema(schemaSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< const bool >::type read_only(read_onlySEXP);
+    connection_deserialize(con, schema, data, read_only);
+    return R_NilValue;
+END_RCPP
+}
+// connection_vfs_stats
+List connection_vfs_stats(const XPtr<DbConnectionPtr>& con, const std::string& schema, const bool reset);
+RcppExport SEXP _RSQLite_connection_vfs_stats(SEXP conSEXP, SEXP schemaSEXP, SEXP resetSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type con(conSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type schema(schemaSEXP);
+    Rcpp::traits::input_parameter< const bool >::type reset(resetSEXP);
+    rcpp_result_gen = Rcpp::wrap(connection_vfs_stats(con, schema, reset));
+    return rcpp_result_gen;
+END_RCPP
+}
+// connection_create_function
+void connection_create_function(const XPtr<DbConnectionPtr>& con, const std::string& name, SEXP fun, const int n_arg, const bool aggregate, const bool deterministic, const int cache_size);
+RcppExport SEXP _RSQLite_connection_create_function(SEXP conSEXP, SEXP nameSEXP, SEXP funSEXP, SEXP n_argSEXP, SEXP aggregateSEXP, SEXP deterministicSEXP, SEXP cache_sizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type con(conSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type name(nameSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type fun(funSEXP);
+    Rcpp::traits::input_parameter< const int >::type n_arg(n_argSEXP);
+    Rcpp::traits::input_parameter< const bool >::type aggregate(aggregateSEXP);
+    Rcpp::traits::input_parameter< const bool >::type deterministic(deterministicSEXP);
+    Rcpp::traits::input_parameter< const int >::type cache_size(cache_sizeSEXP);
+    connection_create_function(con, name, fun, n_arg, aggregate, deterministic, cache_size);
+    return R_NilValue;
+END_RCPP
+}
+// connection_remove_function
+void connection_remove_function(const XPtr<DbConnectionPtr>& con, const std::string& name, const int n_arg);
+RcppExport SEXP _RSQLite_connection_remove_function(SEXP conSEXP, SEXP nameSEXP, SEXP n_argSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type con(conSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type name(nameSEXP);
+    Rcpp::traits::input_parameter< const int >::type n_arg(n_argSEXP);
+    connection_remove_function(con, name, n_arg);
+    return R_NilValue;
+END_RCPP
+}
+// connection_list_tables
+CharacterVector connection_list_tables(const XPtr<DbConnectionPtr>& con);
+RcppExport SEXP _RSQLite_connection_list_tables(SEXP conSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type con(conSEXP);
+    rcpp_result_gen = Rcpp::wrap(connection_list_tables(con));
+    return rcpp_result_gen;
+END_RCPP
+}
+// connection_exists_table
+bool connection_exists_table(const XPtr<DbConnectionPtr>& con, const std::string& schema, const std::string& name);
+RcppExport SEXP _RSQLite_connection_exists_table(SEXP conSEXP, SEXP schemaSEXP, SEXP nameSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type con(conSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type schema(schemaSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type name(nameSEXP);
+    rcpp_result_gen = Rcpp::wrap(connection_exists_table(con, schema, name));
+    return rcpp_result_gen;
+END_RCPP
+}
+// connection_list_fields
+CharacterVector connection_list_fields(const XPtr<DbConnectionPtr>& con, const std::string& schema, const std::string& name);
+RcppExport SEXP _RSQLite_connection_list_fields(SEXP conSEXP, SEXP schemaSEXP, SEXP nameSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type con(conSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type schema(schemaSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type name(nameSEXP);
+    rcpp_result_gen = Rcpp::wrap(connection_list_fields(con, schema, name));
+    return rcpp_result_gen;
+END_RCPP
+}
+// extension_init
+void extension_init(XPtr<DbConnectionPtr> con, const std::string& name);
+RcppExport SEXP _RSQLite_extension_init(SEXP conSEXP, SEXP nameSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< XPtr<DbConnectionPtr> >::type con(conSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type name(nameSEXP);
+    extension_init(con, name);
+    return R_NilValue;
+END_RCPP
+}
+// pool_checkout
+SEXP pool_checkout(const std::string& key);
+RcppExport SEXP _RSQLite_pool_checkout(SEXP keySEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type key(keySEXP);
+    rcpp_result_gen = Rcpp::wrap(pool_checkout(key));
+    return rcpp_result_gen;
+END_RCPP
+}
+// pool_adopt
+void pool_adopt(const XPtr<DbConnectionPtr>& con, const std::string& key);
+RcppExport SEXP _RSQLite_pool_adopt(SEXP conSEXP, SEXP keySEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const XPtr<DbConnectionPtr>& >::type con(conSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type key(keySEXP);
+    pool_adopt(con, key);
+    return R_NilValue;
+END_RCPP
+}
+// pool_checkin
+bool pool_checkin(XPtr<DbConnectionPtr> con);
+RcppExport SEXP _RSQLite_pool_checkin(SEXP conSEXP) {
 BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< XPtr<DbConnectionPtr> >::type con(conSEXP);
-    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
-    Rcpp::traits::input_parameter< const std::string& >::type entry_point(entry_pointSEXP);
-    extension_load(con, file, entry_point);
+    rcpp_result_gen = Rcpp::wrap(pool_checkin(con));
+    return rcpp_result_gen;
+END_RCPP
+}
+// pool_configure
+void pool_configure(const int max_idle, const int statement_cache, const bool readers);
+RcppExport SEXP _RSQLite_pool_configure(SEXP max_idleSEXP, SEXP statement_cacheSEXP, SEXP readersSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const int >::type max_idle(max_idleSEXP);
+    Rcpp::traits::input_parameter< const int >::type statement_cache(statement_cacheSEXP);
+    Rcpp::traits::input_parameter< const bool >::type readers(readersSEXP);
+    pool_configure(max_idle, statement_cache, readers);
+    return R_NilValue;
+END_RCPP
+}
+// pool_config
+List pool_config();
+RcppExport SEXP _RSQLite_pool_config() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(pool_config());
+    return rcpp_result_gen;
+END_RCPP
+}
+// pool_stats
+List pool_stats(const bool reset);
+RcppExport SEXP _RSQLite_pool_stats(SEXP resetSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const bool >::type reset(resetSEXP);
+    rcpp_result_gen = Rcpp::wrap(pool_stats(reset));
+    return rcpp_result_gen;
+END_RCPP
+}
+// pool_clear
+void pool_clear();
+RcppExport SEXP _RSQLite_pool_clear() {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    pool_clear();
     return R_NilValue;
 END_RCPP
 }
@@ -142,6 +402,19 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// result_fetch_chunks
+int result_fetch_chunks(DbResult* res, const int n, SEXP callback);
+RcppExport SEXP _RSQLite_result_fetch_chunks(SEXP resSEXP, SEXP nSEXP, SEXP callbackSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< DbResult* >::type res(resSEXP);
+    Rcpp::traits::input_parameter< const int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type callback(callbackSEXP);
+    rcpp_result_gen = Rcpp::wrap(result_fetch_chunks(res, n, callback));
+    return rcpp_result_gen;
+END_RCPP
+}
 // result_bind
 void result_bind(DbResult* res, List params);
 RcppExport SEXP _RSQLite_result_bind(SEXP resSEXP, SEXP paramsSEXP) {
@@ -208,6 +481,29 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// result_set_group_column
+void result_set_group_column(SqliteResult* res, const std::string& name);
+RcppExport SEXP _RSQLite_result_set_group_column(SEXP resSEXP, SEXP nameSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SqliteResult* >::type res(resSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type name(nameSEXP);
+    result_set_group_column(res, name);
+    return R_NilValue;
+END_RCPP
+}
+// result_set_col_types
+void result_set_col_types(SqliteResult* res, std::vector<std::string> names, std::vector<std::string> types);
+RcppExport SEXP _RSQLite_result_set_col_types(SEXP resSEXP, SEXP namesSEXP, SEXP typesSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SqliteResult* >::type res(resSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type names(namesSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type types(typesSEXP);
+    result_set_col_types(res, names, types);
+    return R_NilValue;
+END_RCPP
+}
 // rsqliteVersion
 CharacterVector rsqliteVersion();
 RcppExport SEXP _RSQLite_rsqliteVersion() {
@@ -228,27 +524,90 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
+// init_memory
+void init_memory(bool pool, int lookaside_size, int lookaside_count, double page_cache);
+RcppExport SEXP _RSQLite_init_memory(SEXP poolSEXP, SEXP lookaside_sizeSEXP, SEXP lookaside_countSEXP, SEXP page_cacheSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< bool >::type pool(poolSEXP);
+    Rcpp::traits::input_parameter< int >::type lookaside_size(lookaside_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type lookaside_count(lookaside_countSEXP);
+    Rcpp::traits::input_parameter< double >::type page_cache(page_cacheSEXP);
+    init_memory(pool, lookaside_size, lookaside_count, page_cache);
+    return R_NilValue;
+END_RCPP
+}
+// memory_stats
+List memory_stats(bool reset);
+RcppExport SEXP _RSQLite_memory_stats(SEXP resetSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< bool >::type reset(resetSEXP);
+    rcpp_result_gen = Rcpp::wrap(memory_stats(reset));
+    return rcpp_result_gen;
+END_RCPP
+}
+// memory_soft_heap_limit
+double memory_soft_heap_limit(double n);
+RcppExport SEXP _RSQLite_memory_soft_heap_limit(SEXP nSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< double >::type n(nSEXP);
+    rcpp_result_gen = Rcpp::wrap(memory_soft_heap_limit(n));
+    return rcpp_result_gen;
+END_RCPP
+}
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_RSQLite_connection_connect", (DL_FUNC) &_RSQLite_connection_connect, 5},
+    {"_RSQLite_backup_init", (DL_FUNC) &_RSQLite_backup_init, 2},
+    {"_RSQLite_backup_release", (DL_FUNC) &_RSQLite_backup_release, 1},
+    {"_RSQLite_backup_run", (DL_FUNC) &_RSQLite_backup_run, 4},
+    {"_RSQLite_backup_start", (DL_FUNC) &_RSQLite_backup_start, 3},
+    {"_RSQLite_backup_progress", (DL_FUNC) &_RSQLite_backup_progress, 1},
+    {"_RSQLite_backup_wait", (DL_FUNC) &_RSQLite_backup_wait, 1},
+    {"_RSQLite_connection_connect", (DL_FUNC) &_RSQLite_connection_connect, 6},
     {"_RSQLite_connection_valid", (DL_FUNC) &_RSQLite_connection_valid, 1},
     {"_RSQLite_connection_release", (DL_FUNC) &_RSQLite_connection_release, 1},
-    {"_RSQLite_connection_copy_database", (DL_FUNC) &_RSQLite_connection_copy_database, 2},
     {"_RSQLite_connection_import_file", (DL_FUNC) &_RSQLite_connection_import_file, 6},
     {"_RSQLite_set_busy_handler", (DL_FUNC) &_RSQLite_set_busy_handler, 2},
-    {"_RSQLite_extension_load", (DL_FUNC) &_RSQLite_extension_load, 3},
+    {"_RSQLite_connection_register_data_frame", (DL_FUNC) &_RSQLite_connection_register_data_frame, 5},
+    {"_RSQLite_connection_unregister_data_frame", (DL_FUNC) &_RSQLite_connection_unregister_data_frame, 2},
+    {"_RSQLite_connection_serialize", (DL_FUNC) &_RSQLite_connection_serialize, 2},
+    {"_RSQLite_connection_deserialize", (DL_FUNC) &_RSQLite_connection_deserialize, 4},
+    {"_RSQLite_connection_vfs_stats", (DL_FUNC) &_RSQLite_connection_vfs_stats, 3},
+    {"_RSQLite_connection_create_function", (DL_FUNC) &_RSQLite_connection_create_function, 7},
+    {"_RSQLite_connection_remove_function", (DL_FUNC) &_RSQLite_connection_remove_function, 3},
+    {"_RSQLite_connection_list_tables", (DL_FUNC) &_RSQLite_connection_list_tables, 1},
+    {"_RSQLite_connection_exists_table", (DL_FUNC) &_RSQLite_connection_exists_table, 3},
+    {"_RSQLite_connection_list_fields", (DL_FUNC) &_RSQLite_connection_list_fields, 3},
+    {"_RSQLite_extension_init", (DL_FUNC) &_RSQLite_extension_init, 2},
+    {"_RSQLite_pool_checkout", (DL_FUNC) &_RSQLite_pool_checkout, 1},
+    {"_RSQLite_pool_adopt", (DL_FUNC) &_RSQLite_pool_adopt, 2},
+    {"_RSQLite_pool_checkin", (DL_FUNC) &_RSQLite_pool_checkin, 1},
+    {"_RSQLite_pool_configure", (DL_FUNC) &_RSQLite_pool_configure, 3},
+    {"_RSQLite_pool_config", (DL_FUNC) &_RSQLite_pool_config, 0},
+    {"_RSQLite_pool_stats", (DL_FUNC) &_RSQLite_pool_stats, 1},
+    {"_RSQLite_pool_clear", (DL_FUNC) &_RSQLite_pool_clear, 0},
     {"_RSQLite_result_create", (DL_FUNC) &_RSQLite_result_create, 2},
     {"_RSQLite_result_release", (DL_FUNC) &_RSQLite_result_release, 1},
     {"_RSQLite_result_valid", (DL_FUNC) &_RSQLite_result_valid, 1},
     {"_RSQLite_result_fetch", (DL_FUNC) &_RSQLite_result_fetch, 2},
+    {"_RSQLite_result_fetch_chunks", (DL_FUNC) &_RSQLite_result_fetch_chunks, 3},
     {"_RSQLite_result_bind", (DL_FUNC) &_RSQLite_result_bind, 2},
     {"_RSQLite_result_has_completed", (DL_FUNC) &_RSQLite_result_has_completed, 1},
     {"_RSQLite_result_rows_fetched", (DL_FUNC) &_RSQLite_result_rows_fetched, 1},
     {"_RSQLite_result_rows_affected", (DL_FUNC) &_RSQLite_result_rows_affected, 1},
     {"_RSQLite_result_column_info", (DL_FUNC) &_RSQLite_result_column_info, 1},
     {"_RSQLite_result_get_placeholder_names", (DL_FUNC) &_RSQLite_result_get_placeholder_names, 1},
+    {"_RSQLite_result_set_group_column", (DL_FUNC) &_RSQLite_result_set_group_column, 2},
+    {"_RSQLite_result_set_col_types", (DL_FUNC) &_RSQLite_result_set_col_types, 3},
     {"_RSQLite_rsqliteVersion", (DL_FUNC) &_RSQLite_rsqliteVersion, 0},
     {"_RSQLite_init_logging", (DL_FUNC) &_RSQLite_init_logging, 1},
+    {"_RSQLite_init_memory", (DL_FUNC) &_RSQLite_init_memory, 4},
+    {"_RSQLite_memory_stats", (DL_FUNC) &_RSQLite_memory_stats, 1},
+    {"_RSQLite_memory_soft_heap_limit", (DL_FUNC) &_RSQLite_memory_soft_heap_limit, 1},
     {NULL, NULL, 0}
 };
 
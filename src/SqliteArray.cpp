@@ -0,0 +1,211 @@
+#include "pch.h"
+#include "SqliteArray.h"
+#include "integer64.h"
+
+
+namespace {
+
+// Pointer type for sqlite3_bind_pointer(), checked by sqlite3_value_pointer()
+const char* const ARRAY_POINTER_TYPE = "RSQLite_array";
+
+enum ArrayKind {
+  ARRAY_INTEGER,
+  ARRAY_REAL,
+  ARRAY_INTEGER64,
+  ARRAY_STRING
+};
+
+struct Array {
+  SEXP x;
+  ArrayKind kind;
+  R_xlen_t n;
+};
+
+enum {
+  ARRAY_COLUMN_VALUE = 0,
+  ARRAY_COLUMN_POINTER = 1
+};
+
+struct ArrayCursor {
+  sqlite3_vtab_cursor base;
+  const Array* pArray;
+  R_xlen_t pos;
+};
+
+void array_delete(void* p) {
+  delete static_cast<Array*>(p);
+}
+
+int array_connect(sqlite3* db, void*, int, const char* const*,
+                  sqlite3_vtab** ppVtab, char**) {
+  int rc = sqlite3_declare_vtab(db, "CREATE TABLE x(value, pointer HIDDEN)");
+  if (rc != SQLITE_OK) return rc;
+
+  sqlite3_vtab* p = static_cast<sqlite3_vtab*>(sqlite3_malloc(sizeof(sqlite3_vtab)));
+  if (p == NULL) return SQLITE_NOMEM;
+  memset(p, 0, sizeof(*p));
+  sqlite3_vtab_config(db, SQLITE_VTAB_INNOCUOUS);
+  *ppVtab = p;
+  return SQLITE_OK;
+}
+
+int array_disconnect(sqlite3_vtab* pVtab) {
+  sqlite3_free(pVtab);
+  return SQLITE_OK;
+}
+
+int array_best_index(sqlite3_vtab*, sqlite3_index_info* pInfo) {
+  for (int i = 0; i < pInfo->nConstraint; ++i) {
+    if (pInfo->aConstraint[i].iColumn != ARRAY_COLUMN_POINTER) continue;
+    if (pInfo->aConstraint[i].op != SQLITE_INDEX_CONSTRAINT_EQ) continue;
+    if (!pInfo->aConstraint[i].usable) return SQLITE_CONSTRAINT;
+
+    pInfo->idxNum = 1;
+    pInfo->aConstraintUsage[i].argvIndex = 1;
+    pInfo->aConstraintUsage[i].omit = 1;
+    pInfo->estimatedCost = 1000;
+    pInfo->estimatedRows = 1000;
+    return SQLITE_OK;
+  }
+
+  // No array, no rows
+  pInfo->idxNum = 0;
+  pInfo->estimatedCost = 2147483647;
+  pInfo->estimatedRows = 2147483647;
+  return SQLITE_OK;
+}
+
+int array_open(sqlite3_vtab*, sqlite3_vtab_cursor** ppCursor) {
+  ArrayCursor* c = static_cast<ArrayCursor*>(sqlite3_malloc(sizeof(ArrayCursor)));
+  if (c == NULL) return SQLITE_NOMEM;
+  memset(c, 0, sizeof(*c));
+  *ppCursor = &c->base;
+  return SQLITE_OK;
+}
+
+int array_close(sqlite3_vtab_cursor* cur) {
+  sqlite3_free(cur);
+  return SQLITE_OK;
+}
+
+int array_filter(sqlite3_vtab_cursor* cur, int idxNum, const char*, int, sqlite3_value** argv) {
+  ArrayCursor* c = reinterpret_cast<ArrayCursor*>(cur);
+  c->pos = 0;
+  c->pArray = NULL;
+  if (idxNum == 1) {
+    c->pArray = static_cast<const Array*>(sqlite3_value_pointer(argv[0], ARRAY_POINTER_TYPE));
+  }
+  return SQLITE_OK;
+}
+
+int array_next(sqlite3_vtab_cursor* cur) {
+  reinterpret_cast<ArrayCursor*>(cur)->pos++;
+  return SQLITE_OK;
+}
+
+int array_eof(sqlite3_vtab_cursor* cur) {
+  const ArrayCursor* c = reinterpret_cast<ArrayCursor*>(cur);
+  return c->pArray == NULL || c->pos >= c->pArray->n;
+}
+
+int array_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int j) {
+  const ArrayCursor* c = reinterpret_cast<ArrayCursor*>(cur);
+  if (j != ARRAY_COLUMN_VALUE) return SQLITE_OK;
+
+  const Array& a = *c->pArray;
+  switch (a.kind) {
+  case ARRAY_INTEGER: {
+    int value = INTEGER(a.x)[c->pos];
+    if (value == NA_INTEGER) sqlite3_result_null(ctx);
+    else sqlite3_result_int(ctx, value);
+    break;
+  }
+  case ARRAY_REAL: {
+    double value = REAL(a.x)[c->pos];
+    if (ISNAN(value)) sqlite3_result_null(ctx);
+    else sqlite3_result_double(ctx, value);
+    break;
+  }
+  case ARRAY_INTEGER64: {
+    int64_t value = INTEGER64(a.x)[c->pos];
+    if (value == NA_INTEGER64) sqlite3_result_null(ctx);
+    else sqlite3_result_int64(ctx, value);
+    break;
+  }
+  case ARRAY_STRING: {
+    SEXP value = STRING_ELT(a.x, c->pos);
+    if (value == NA_STRING) sqlite3_result_null(ctx);
+    else sqlite3_result_text(ctx, CHAR(value), Rf_length(value), SQLITE_STATIC);
+    break;
+  }
+  }
+  return SQLITE_OK;
+}
+
+int array_rowid(sqlite3_vtab_cursor* cur, sqlite_int64* pRowid) {
+  *pRowid = reinterpret_cast<ArrayCursor*>(cur)->pos + 1;
+  return SQLITE_OK;
+}
+
+sqlite3_module array_module = {
+  0,                 // iVersion
+  NULL,              // xCreate, eponymous only
+  array_connect,     // xConnect
+  array_best_index,  // xBestIndex
+  array_disconnect,  // xDisconnect
+  array_disconnect,  // xDestroy
+  array_open,        // xOpen
+  array_close,       // xClose
+  array_filter,      // xFilter
+  array_next,        // xNext
+  array_eof,         // xEof
+  array_column,      // xColumn
+  array_rowid,       // xRowid
+  NULL,              // xUpdate
+  NULL,              // xBegin
+  NULL,              // xSync
+  NULL,              // xCommit
+  NULL,              // xRollback
+  NULL,              // xFindFunction
+  NULL,              // xRename
+  NULL,              // xSavepoint
+  NULL,              // xRelease
+  NULL,              // xRollbackTo
+  NULL               // xShadowName
+};
+
+}
+
+void SqliteArray::bind(sqlite3_stmt* stmt, int j, SEXP x) {
+  ArrayKind kind;
+  if (TYPEOF(x) == LGLSXP || TYPEOF(x) == INTSXP) {
+    kind = ARRAY_INTEGER;
+  }
+  else if (TYPEOF(x) == INT64SXP && Rf_inherits(x, "integer64")) {
+    kind = ARRAY_INTEGER64;
+  }
+  else if (TYPEOF(x) == REALSXP) {
+    kind = ARRAY_REAL;
+  }
+  else if (TYPEOF(x) == STRSXP) {
+    kind = ARRAY_STRING;
+  }
+  else {
+    stop("Don't know how to bind array of type %s.", Rf_type2char(TYPEOF(x)));
+  }
+
+  Array* pArray = new Array;
+  pArray->x = x;
+  pArray->kind = kind;
+  pArray->n = Rf_xlength(x);
+
+  // Frees pArray also on failure
+  int rc = sqlite3_bind_pointer(stmt, j, pArray, ARRAY_POINTER_TYPE, array_delete);
+  if (rc != SQLITE_OK) {
+    stop("Could not bind array:\n%s", sqlite3_errmsg(sqlite3_db_handle(stmt)));
+  }
+}
+
+int SqliteArray::register_module(sqlite3* conn) {
+  return sqlite3_create_module(conn, "carray", &array_module, NULL);
+}
@@ -0,0 +1,23 @@
+#ifndef __RSQLITE_SQLITE_ARRAY__
+#define __RSQLITE_SQLITE_ARRAY__
+
+#include "sqlite3-cpp.h"
+
+// An R vector bound by pointer to a parameter of the "carray" table-valued
+// function, as in
+//
+//   SELECT * FROM x WHERE id IN carray(?)
+//
+// The vector is not copied, it must stay alive as long as it is bound.
+// The parameter list of the result keeps it alive.
+
+class SqliteArray {
+public:
+  // Binds x to parameter j of a statement
+  static void bind(sqlite3_stmt* stmt, int j, SEXP x);
+
+  // Registers the eponymous "carray" module
+  static int register_module(sqlite3* conn);
+};
+
+#endif // __RSQLITE_SQLITE_ARRAY__
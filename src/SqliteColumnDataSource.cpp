@@ -60,8 +60,8 @@ bool SqliteColumnDataSource::is_null() const {
 }
 
 int SqliteColumnDataSource::fetch_bool() const {
-  // No such data type
-  return 0;
+  // Only for columns with a fixed type
+  return sqlite3_column_double(get_stmt(), get_j()) != 0;
 }
 
 int SqliteColumnDataSource::fetch_int() const {
@@ -4,8 +4,9 @@
 
 
 SqliteDataFrame::SqliteDataFrame(sqlite3_stmt* stmt, std::vector<std::string> names, const int n_max_,
-                                 const std::vector<DATA_TYPE>& types, bool with_alt_types) :
-  DbDataFrame(new SqliteColumnDataSourceFactory(stmt, with_alt_types), names, n_max_, types)
+                                 const std::vector<DATA_TYPE>& types, const std::vector<DATA_TYPE>& fixed_types,
+                                 bool with_alt_types, DATA_TYPE bigint) :
+  DbDataFrame(new SqliteColumnDataSourceFactory(stmt, with_alt_types), names, n_max_, types, fixed_types, bigint)
 {
 }
 
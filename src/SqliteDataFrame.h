@@ -7,7 +7,7 @@
 class SqliteDataFrame : public DbDataFrame {
 public:
   SqliteDataFrame(sqlite3_stmt* stmt, std::vector<std::string> names, const int n_max_, const std::vector<DATA_TYPE>& types,
-                  bool with_alt_types);
+                  const std::vector<DATA_TYPE>& fixed_types, bool with_alt_types, DATA_TYPE bigint);
   virtual ~SqliteDataFrame();
 };
 
@@ -0,0 +1,349 @@
+#include "pch.h"
+#include "SqliteRFunction.h"
+#include "integer64.h"
+#include <climits>
+
+
+// Buffer ----------------------------------------------------------------------
+
+SqliteRFunction::Buffer::Buffer() :
+  type_(SQLITE_NULL)
+{
+}
+
+void SqliteRFunction::Buffer::append(sqlite3_value* value) {
+  const int type = sqlite3_value_type(value);
+
+  if (type != SQLITE_NULL) {
+    if (type_ == SQLITE_NULL) {
+      type_ = type;
+    }
+    else if (type_ == SQLITE_INTEGER && type == SQLITE_FLOAT) {
+      // Integers are promoted, not truncated
+      d_.assign(i_.begin(), i_.end());
+      i_.clear();
+      type_ = SQLITE_FLOAT;
+    }
+  }
+
+  // Values are stored also for NULL, to keep positions aligned
+  const size_t n = na_.size();
+  na_.push_back(type == SQLITE_NULL);
+
+  switch (type_) {
+  case SQLITE_INTEGER:
+    i_.resize(n);
+    i_.push_back(sqlite3_value_int64(value));
+    break;
+  case SQLITE_FLOAT:
+    d_.resize(n);
+    d_.push_back(sqlite3_value_double(value));
+    break;
+  case SQLITE_TEXT: {
+    s_.resize(n + 1);
+    const char* text = reinterpret_cast<const char*>(sqlite3_value_text(value));
+    if (text != NULL) s_[n].assign(text, sqlite3_value_bytes(value));
+    break;
+  }
+  case SQLITE_BLOB: {
+    s_.resize(n + 1);
+    const char* blob = static_cast<const char*>(sqlite3_value_blob(value));
+    if (blob != NULL) s_[n].assign(blob, sqlite3_value_bytes(value));
+    break;
+  }
+  }
+}
+
+R_xlen_t SqliteRFunction::Buffer::size() const {
+  return static_cast<R_xlen_t>(na_.size());
+}
+
+SEXP SqliteRFunction::Buffer::to_r() const {
+  const R_xlen_t n = size();
+
+  switch (type_) {
+  case SQLITE_INTEGER: {
+    // Integers that do not fit into 32 bits are passed as doubles
+    bool fits = true;
+    for (R_xlen_t i = 0; i < n && fits; ++i) {
+      fits = na_[i] || (i_[i] > INT_MIN && i_[i] <= INT_MAX);
+    }
+    if (fits) {
+      IntegerVector x(n);
+      for (R_xlen_t i = 0; i < n; ++i) {
+        x[i] = na_[i] ? NA_INTEGER : static_cast<int>(i_[i]);
+      }
+      return x;
+    }
+    NumericVector x(n);
+    for (R_xlen_t i = 0; i < n; ++i) {
+      x[i] = na_[i] ? NA_REAL : static_cast<double>(i_[i]);
+    }
+    return x;
+  }
+  case SQLITE_FLOAT: {
+    NumericVector x(n);
+    for (R_xlen_t i = 0; i < n; ++i) {
+      x[i] = na_[i] ? NA_REAL : d_[i];
+    }
+    return x;
+  }
+  case SQLITE_TEXT: {
+    CharacterVector x(n);
+    for (R_xlen_t i = 0; i < n; ++i) {
+      if (na_[i]) x[i] = NA_STRING;
+      else x[i] = Rf_mkCharLenCE(s_[i].data(), static_cast<int>(s_[i].size()), CE_UTF8);
+    }
+    return x;
+  }
+  case SQLITE_BLOB: {
+    List x(n);
+    for (R_xlen_t i = 0; i < n; ++i) {
+      if (na_[i]) continue;
+      RawVector blob(static_cast<R_xlen_t>(s_[i].size()));
+      if (!s_[i].empty()) memcpy(RAW(blob), s_[i].data(), s_[i].size());
+      x[i] = blob;
+    }
+    return x;
+  }
+  }
+
+  // Only NULL values
+  return LogicalVector(n, NA_LOGICAL);
+}
+
+
+// SqliteRFunction -------------------------------------------------------------
+
+SqliteRFunction::SqliteRFunction(SEXP fun, int n_arg, int cache_size) :
+  fun_(fun),
+  n_arg_(n_arg),
+  cache_size_(cache_size > 0 ? cache_size : 0)
+{
+  R_PreserveObject(fun_);
+}
+
+SqliteRFunction::~SqliteRFunction() {
+  R_ReleaseObject(fun_);
+}
+
+int SqliteRFunction::create(sqlite3* conn, const std::string& name, SEXP fun, int n_arg,
+                            bool aggregate, bool deterministic, int cache_size) {
+  // Results of aggregates and of functions with side effects are not cached
+  SqliteRFunction* p = new SqliteRFunction(fun, n_arg,
+                                           (deterministic && !aggregate) ? cache_size : 0);
+  const int flags = SQLITE_UTF8 | (deterministic ? SQLITE_DETERMINISTIC : 0);
+
+  // Destroys p also on failure
+  if (aggregate) {
+    return sqlite3_create_function_v2(conn, name.c_str(), n_arg, flags, p,
+                                      NULL, step_callback, final_callback, destroy_callback);
+  }
+  return sqlite3_create_function_v2(conn, name.c_str(), n_arg, flags, p,
+                                    scalar_callback, NULL, NULL, destroy_callback);
+}
+
+bool SqliteRFunction::call(sqlite3_context* ctx, const std::vector<Buffer>& args, Value* value) const {
+  try {
+    List r_args(args.size());
+    for (size_t i = 0; i < args.size(); ++i) {
+      r_args[i] = args[i].to_r();
+    }
+
+    Shield<SEXP> pairs(Rf_VectorToPairList(r_args));
+    Shield<SEXP> expr(Rf_lcons(fun_, pairs));
+    RObject result(Rcpp_eval(expr, R_GlobalEnv));
+    to_value(result, value);
+    return true;
+  }
+  catch (Rcpp::internal::InterruptedException&) {
+    sqlite3_result_error(ctx, "Interrupted", -1);
+  }
+  catch (std::exception& e) {
+    sqlite3_result_error(ctx, e.what(), -1);
+  }
+  catch (...) {
+    sqlite3_result_error(ctx, "R function failed", -1);
+  }
+  return false;
+}
+
+void SqliteRFunction::to_value(SEXP x, Value* value) {
+  value->type = SQLITE_NULL;
+  value->s.clear();
+
+  if (TYPEOF(x) == NILSXP) return;
+
+  // A raw vector is a single blob
+  if (TYPEOF(x) == RAWSXP) {
+    value->type = SQLITE_BLOB;
+    value->s.assign(reinterpret_cast<const char*>(RAW(x)), Rf_xlength(x));
+    return;
+  }
+
+  if (Rf_xlength(x) != 1) {
+    stop("R function must return a single value, not %d", static_cast<int>(Rf_xlength(x)));
+  }
+
+  switch (TYPEOF(x)) {
+  case LGLSXP:
+    if (LOGICAL(x)[0] == NA_LOGICAL) return;
+    value->type = SQLITE_INTEGER;
+    value->i = LOGICAL(x)[0];
+    break;
+  case INTSXP:
+    if (INTEGER(x)[0] == NA_INTEGER) return;
+    if (Rf_isFactor(x)) {
+      value->type = SQLITE_TEXT;
+      value->s = Rf_translateCharUTF8(STRING_ELT(Rf_getAttrib(x, R_LevelsSymbol), INTEGER(x)[0] - 1));
+      return;
+    }
+    value->type = SQLITE_INTEGER;
+    value->i = INTEGER(x)[0];
+    break;
+  case REALSXP:
+    if (Rf_inherits(x, "integer64")) {
+      if (INTEGER64(x)[0] == NA_INTEGER64) return;
+      value->type = SQLITE_INTEGER;
+      value->i = INTEGER64(x)[0];
+      return;
+    }
+    if (ISNAN(REAL(x)[0])) return;
+    value->type = SQLITE_FLOAT;
+    value->d = REAL(x)[0];
+    break;
+  case STRSXP:
+    if (STRING_ELT(x, 0) == NA_STRING) return;
+    value->type = SQLITE_TEXT;
+    value->s = Rf_translateCharUTF8(STRING_ELT(x, 0));
+    break;
+  case VECSXP:
+    // A blob object of length one
+    if (TYPEOF(VECTOR_ELT(x, 0)) == NILSXP) return;
+    if (TYPEOF(VECTOR_ELT(x, 0)) != RAWSXP) stop("R function must return an atomic value or a blob");
+    to_value(VECTOR_ELT(x, 0), value);
+    break;
+  default:
+    stop("R function must return an atomic value or a blob");
+  }
+}
+
+void SqliteRFunction::set_result(sqlite3_context* ctx, const Value& value) {
+  switch (value.type) {
+  case SQLITE_INTEGER:
+    sqlite3_result_int64(ctx, value.i);
+    break;
+  case SQLITE_FLOAT:
+    sqlite3_result_double(ctx, value.d);
+    break;
+  case SQLITE_TEXT:
+    sqlite3_result_text64(ctx, value.s.data(), value.s.size(), SQLITE_TRANSIENT, SQLITE_UTF8);
+    break;
+  case SQLITE_BLOB:
+    sqlite3_result_blob64(ctx, value.s.data(), value.s.size(), SQLITE_TRANSIENT);
+    break;
+  default:
+    sqlite3_result_null(ctx);
+  }
+}
+
+void SqliteRFunction::append_key(std::string* key, sqlite3_value* value) {
+  const int type = sqlite3_value_type(value);
+  key->push_back(static_cast<char>(type));
+
+  switch (type) {
+  case SQLITE_INTEGER: {
+    const sqlite3_int64 i = sqlite3_value_int64(value);
+    key->append(reinterpret_cast<const char*>(&i), sizeof(i));
+    break;
+  }
+  case SQLITE_FLOAT: {
+    const double d = sqlite3_value_double(value);
+    key->append(reinterpret_cast<const char*>(&d), sizeof(d));
+    break;
+  }
+  case SQLITE_TEXT:
+  case SQLITE_BLOB: {
+    const char* data = static_cast<const char*>(
+      type == SQLITE_TEXT ? static_cast<const void*>(sqlite3_value_text(value)) : sqlite3_value_blob(value)
+    );
+    const int n = sqlite3_value_bytes(value);
+    key->append(reinterpret_cast<const char*>(&n), sizeof(n));
+    if (n > 0) key->append(data, n);
+    break;
+  }
+  }
+}
+
+void SqliteRFunction::scalar_callback(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+  SqliteRFunction* p = static_cast<SqliteRFunction*>(sqlite3_user_data(ctx));
+
+  try {
+    std::string key;
+    if (p->cache_size_ > 0) {
+      for (int i = 0; i < argc; ++i) append_key(&key, argv[i]);
+      std::map<std::string, Value>::const_iterator it = p->cache_.find(key);
+      if (it != p->cache_.end()) {
+        set_result(ctx, it->second);
+        return;
+      }
+    }
+
+    std::vector<Buffer> args(argc);
+    for (int i = 0; i < argc; ++i) args[i].append(argv[i]);
+
+    Value value;
+    if (!p->call(ctx, args, &value)) return;
+
+    if (p->cache_size_ > 0) {
+      if (p->cache_.size() >= p->cache_size_) p->cache_.clear();
+      p->cache_[key] = value;
+    }
+    set_result(ctx, value);
+  }
+  catch (std::bad_alloc&) {
+    sqlite3_result_error_nomem(ctx);
+  }
+}
+
+// The aggregate context holds a pointer to the buffers of the group,
+// which is NULL until the first row has been seen
+
+void SqliteRFunction::step_callback(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+  std::vector<Buffer>** group = static_cast<std::vector<Buffer>**>(
+    sqlite3_aggregate_context(ctx, sizeof(std::vector<Buffer>*))
+  );
+  if (group == NULL) {
+    sqlite3_result_error_nomem(ctx);
+    return;
+  }
+
+  try {
+    if (*group == NULL) *group = new std::vector<Buffer>(argc);
+    for (int i = 0; i < argc; ++i) (**group)[i].append(argv[i]);
+  }
+  catch (std::bad_alloc&) {
+    sqlite3_result_error_nomem(ctx);
+  }
+}
+
+void SqliteRFunction::final_callback(sqlite3_context* ctx) {
+  SqliteRFunction* p = static_cast<SqliteRFunction*>(sqlite3_user_data(ctx));
+  std::vector<Buffer>** group = static_cast<std::vector<Buffer>**>(sqlite3_aggregate_context(ctx, 0));
+
+  Value value;
+  if (group != NULL && *group != NULL) {
+    if (p->call(ctx, **group, &value)) set_result(ctx, value);
+    delete *group;
+    *group = NULL;
+  }
+  else {
+    // No rows, called with empty vectors
+    std::vector<Buffer> empty(p->n_arg_ > 0 ? p->n_arg_ : 0);
+    if (p->call(ctx, empty, &value)) set_result(ctx, value);
+  }
+}
+
+void SqliteRFunction::destroy_callback(void* p) {
+  delete static_cast<SqliteRFunction*>(p);
+}
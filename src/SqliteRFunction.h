@@ -0,0 +1,71 @@
+#ifndef __RSQLITE_SQLITE_R_FUNCTION__
+#define __RSQLITE_SQLITE_R_FUNCTION__
+
+#include <boost/noncopyable.hpp>
+#include <map>
+#include "sqlite3-cpp.h"
+
+// An R function that is called from SQL.
+//
+// Aggregates buffer the arguments of each group in typed vectors and call
+// the R function once per group, with one vector per argument.
+// Scalar functions are called with vectors of length one; results of
+// deterministic functions are cached by argument values, so that the
+// R function is called only once for each distinct set of arguments.
+
+class SqliteRFunction : boost::noncopyable {
+public:
+  // A SQL value, the member for the type is used; text and blobs in s
+  struct Value {
+    int type;
+    sqlite3_int64 i;
+    double d;
+    std::string s;
+  };
+
+  // The values of one argument, typed after the first value that is not
+  // NULL; later values are converted to that type
+  class Buffer {
+  public:
+    Buffer();
+    void append(sqlite3_value* value);
+    R_xlen_t size() const;
+    SEXP to_r() const;
+
+  private:
+    int type_;
+    std::vector<bool> na_;
+    std::vector<sqlite3_int64> i_;
+    std::vector<double> d_;
+    std::vector<std::string> s_;
+  };
+
+public:
+  SqliteRFunction(SEXP fun, int n_arg, int cache_size);
+  ~SqliteRFunction();
+
+  // Creates the SQL function name with n_arg arguments, -1 for any number;
+  // the connection owns the function object
+  static int create(sqlite3* conn, const std::string& name, SEXP fun, int n_arg,
+                    bool aggregate, bool deterministic, int cache_size);
+
+private:
+  SEXP fun_;
+  const int n_arg_;
+  const size_t cache_size_;
+  std::map<std::string, Value> cache_;
+
+  // Calls the R function with one vector per argument, sets an error
+  // result and returns false on failure
+  bool call(sqlite3_context* ctx, const std::vector<Buffer>& args, Value* value) const;
+  static void to_value(SEXP x, Value* value);
+  static void set_result(sqlite3_context* ctx, const Value& value);
+  static void append_key(std::string* key, sqlite3_value* value);
+
+  static void scalar_callback(sqlite3_context* ctx, int argc, sqlite3_value** argv);
+  static void step_callback(sqlite3_context* ctx, int argc, sqlite3_value** argv);
+  static void final_callback(sqlite3_context* ctx);
+  static void destroy_callback(void* p);
+};
+
+#endif // __RSQLITE_SQLITE_R_FUNCTION__
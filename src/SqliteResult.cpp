@@ -22,3 +22,12 @@ DbResult* SqliteResult::create_and_send_query(const DbConnectionPtr& con, const
 CharacterVector SqliteResult::get_placeholder_names() const {
   return impl->get_placeholder_names();
 }
+
+void SqliteResult::set_group_column(const std::string& name) {
+  impl->set_group_column(name);
+}
+
+void SqliteResult::set_col_types(const std::vector<std::string>& names,
+                                 const std::vector<std::string>& types) {
+  impl->set_col_types(names, types);
+}
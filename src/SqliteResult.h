@@ -14,6 +14,8 @@ public:
 
 public:
   CharacterVector get_placeholder_names() const;
+  void set_group_column(const std::string& name);
+  void set_col_types(const std::vector<std::string>& names, const std::vector<std::string>& types);
 };
 
 #endif
@@ -3,15 +3,22 @@
 #include "SqliteDataFrame.h"
 #include "DbColumnStorage.h"
 #include "DbConnection.h"
+#include "SqliteArray.h"
 #include "integer64.h"
+#include <algorithm>
 
 
 
 // Construction ////////////////////////////////////////////////////////////////
 
 SqliteResultImpl::SqliteResultImpl(const DbConnectionPtr& conn_, const std::string& sql) :
-  conn(conn_->conn()),
-  stmt(prepare(conn, sql)),
+  owner_(conn_.get()),
+  sql_(sql),
+  cacheable_(true),
+  generation_(-1),
+  stmt(prepare()),
+  conn(owner_->conn()),
+  rollback_(is_rollback(stmt)),
   cache(stmt),
   complete_(false),
   ready_(false),
@@ -20,7 +27,9 @@ SqliteResultImpl::SqliteResultImpl(const DbConnectionPtr& conn_, const std::stri
   group_(0),
   groups_(0),
   types_(get_initial_field_types(cache.ncols_)),
-  with_alt_types_(conn_->with_alt_types())
+  col_types_(get_initial_field_types(cache.ncols_)),
+  with_alt_types_(conn_->with_alt_types()),
+  bigint_(bigint_from_name(conn_->bigint()))
 {
 
   LOG_DEBUG << sql;
@@ -40,7 +49,12 @@ SqliteResultImpl::~SqliteResultImpl() {
   LOG_VERBOSE;
 
   try {
-    sqlite3_finalize(stmt);
+    if (cacheable_) {
+      owner_->release_statement(sql_, stmt, generation_);
+    }
+    else {
+      sqlite3_finalize(stmt);
+    }
   } catch (...) {}
 }
 
@@ -75,7 +89,46 @@ std::vector<DATA_TYPE> SqliteResultImpl::get_initial_field_types(const size_t nc
   return types;
 }
 
-sqlite3_stmt* SqliteResultImpl::prepare(sqlite3* conn, const std::string& sql) {
+// Types requested with col_types, DT_UNKNOWN for columns that are guessed
+DATA_TYPE SqliteResultImpl::datatype_from_name(const std::string& type) {
+  if (type == "logical") return DT_BOOL;
+  if (type == "integer") return DT_INT;
+  if (type == "integer64") return DT_INT64;
+  if (type == "double") return DT_REAL;
+  if (type == "character") return DT_STRING;
+  if (type == "blob") return DT_BLOB;
+  if (type == "Date") return DT_DATE;
+  if (type == "POSIXct") return DT_DATETIME;
+  if (type == "hms") return DT_TIME;
+  if (type.empty()) return DT_UNKNOWN;
+  stop("Unknown column type: %s", type);
+}
+
+// The type of 64-bit integer columns with a guessed type
+DATA_TYPE SqliteResultImpl::bigint_from_name(const std::string& bigint) {
+  if (bigint == "integer") return DT_INT;
+  if (bigint == "numeric") return DT_REAL;
+  if (bigint == "character") return DT_STRING;
+  return DT_INT64;
+}
+
+// Statements are reused from the cache of the connection, read-only queries
+// may move to its reader
+sqlite3_stmt* SqliteResultImpl::prepare() {
+  sqlite3_stmt* stmt = owner_->take_statement(sql_, generation_);
+  if (stmt == NULL) {
+    bool has_tail = false;
+    stmt = prepare(owner_->conn(), sql_, has_tail);
+    // The warning about the remaining part is given each time
+    cacheable_ = !has_tail;
+  }
+  if (cacheable_ && stmt != NULL) {
+    owner_ = owner_->route(sql_, stmt, generation_);
+  }
+  return stmt;
+}
+
+sqlite3_stmt* SqliteResultImpl::prepare(sqlite3* conn, const std::string& sql, bool& has_tail) {
   sqlite3_stmt* stmt = NULL;
 
   const char* tail = NULL;
@@ -91,6 +144,7 @@ sqlite3_stmt* SqliteResultImpl::prepare(sqlite3* conn, const std::string& sql) {
   if (tail) {
     while (isspace(*tail)) ++tail;
     if (*tail) {
+      has_tail = true;
       Rcpp::warningcall(R_NilValue, std::string("Ignoring remaining part of query: ") + tail);
     }
   }
@@ -98,6 +152,14 @@ sqlite3_stmt* SqliteResultImpl::prepare(sqlite3* conn, const std::string& sql) {
   return stmt;
 }
 
+// ROLLBACK and ROLLBACK TO restore an earlier schema version
+bool SqliteResultImpl::is_rollback(sqlite3_stmt* stmt) {
+  if (stmt == NULL) return false;
+  const char* sql = sqlite3_sql(stmt);
+  while (isspace(*sql)) ++sql;
+  return sqlite3_strnicmp(sql, "rollback", 8) == 0 && !isalnum(sql[8]) && sql[8] != '_';
+}
+
 void SqliteResultImpl::init(bool params_have_rows) {
   ready_ = true;
   nrows_ = 0;
@@ -136,8 +198,15 @@ void SqliteResultImpl::bind(const List& params) {
 
   set_params(params);
 
-  SEXP first_col = params[0];
-  groups_ = Rf_length(first_col);
+  // Arrays are bound as a whole for each group of parameters
+  groups_ = 1;
+  for (R_xlen_t j = 0; j < params.size(); ++j) {
+    SEXP col = params[j];
+    if (!Rf_inherits(col, "sqlite_array")) {
+      groups_ = Rf_length(col);
+      break;
+    }
+  }
   group_ = 0;
 
   total_changes_start_ = sqlite3_total_changes(conn);
@@ -161,6 +230,57 @@ List SqliteResultImpl::fetch(const int n_max) {
   return out;
 }
 
+// Calls callback with data frames of up to n rows until the result is
+// complete or the callback returns FALSE.  The data frame is bound to `chunk`
+// in a private environment only while the callback runs, so that R's
+// reference counts tell whether the callback has kept it; if not, its
+// vectors are filled again for the next chunk.
+int SqliteResultImpl::fetch_chunks(const int n, SEXP callback) {
+  if (!ready_)
+    stop("Query needs to be bound before fetching");
+  if (!group_column_.empty())
+    stop("Cannot fetch chunks with a group column");
+
+  SqliteDataFrame data(stmt, cache.names_, n, types_, col_types_, with_alt_types_, bigint_);
+
+  Environment env = Environment::global_env().new_child(false);
+  SEXP chunk_sym = Rf_install("chunk");
+  Shield<SEXP> call(Rf_lang2(callback, chunk_sym));
+
+  SEXP chunk = R_NilValue;
+  PROTECT_INDEX ipx;
+  PROTECT_WITH_INDEX(chunk, &ipx);
+
+  int total = 0;
+  while (!complete_) {
+    data.reset();
+
+    int rows = 0;
+    while (!complete_) {
+      data.set_col_values();
+      step();
+      nrows_++;
+      rows++;
+      if (!data.advance())
+        break;
+    }
+
+    chunk = data.get_chunk(types_, chunk);
+    REPROTECT(chunk, ipx);
+    total += rows;
+
+    Rf_defineVar(chunk_sym, chunk, env);
+    RObject ret(Rcpp_eval(call, env));
+    Rf_defineVar(chunk_sym, R_NilValue, env);
+
+    if (TYPEOF(ret) == LGLSXP && Rf_xlength(ret) == 1 && LOGICAL(ret)[0] == FALSE)
+      break;
+  }
+
+  UNPROTECT(1);
+  return total;
+}
+
 List SqliteResultImpl::get_column_info() {
   peek_first_row();
 
@@ -208,12 +328,44 @@ CharacterVector SqliteResultImpl::get_placeholder_names() const {
   return res;
 }
 
+void SqliteResultImpl::set_group_column(const std::string& name) {
+  group_column_ = name;
+}
+
+void SqliteResultImpl::set_col_types(const std::vector<std::string>& names,
+                                     const std::vector<std::string>& types) {
+  std::vector<DATA_TYPE> col_types = get_initial_field_types(cache.ncols_);
+
+  if (names.empty()) {
+    if (!types.empty() && types.size() != cache.ncols_) {
+      stop("Need one column type per column (%i), or named column types; %i supplied.",
+           (int)cache.ncols_, (int)types.size());
+    }
+    for (size_t j = 0; j < types.size(); ++j) {
+      col_types[j] = datatype_from_name(types[j]);
+    }
+  }
+  else {
+    for (size_t k = 0; k < names.size(); ++k) {
+      std::vector<std::string>::const_iterator it =
+        std::find(cache.names_.begin(), cache.names_.end(), names[k]);
+      if (it == cache.names_.end()) {
+        stop("Column not found in result: %s", names[k]);
+      }
+      col_types[it - cache.names_.begin()] = datatype_from_name(types[k]);
+    }
+  }
+
+  col_types_ = col_types;
+}
+
 
 
 // Privates ////////////////////////////////////////////////////////////////////
 
 void SqliteResultImpl::set_params(const List& params) {
   params_ = params;
+  utf8_cache_.clear();
 }
 
 bool SqliteResultImpl::bind_row() {
@@ -225,6 +377,10 @@ bool SqliteResultImpl::bind_row() {
   sqlite3_reset(stmt);
   sqlite3_clear_bindings(stmt);
 
+  // Nothing is bound to the translated strings now
+  if (utf8_cache_.size() > 1000)
+    utf8_cache_.clear();
+
   for (R_xlen_t j = 0; j < params_.size(); ++j) {
     // sqlite parameters are 1-indexed
     bind_parameter_pos((int)j + 1, params_[j]);
@@ -252,6 +408,15 @@ void SqliteResultImpl::bind_parameter_pos(int j, SEXP value_) {
       sqlite3_bind_int64(stmt, j, value);
     }
   }
+  else if (TYPEOF(value_) == INTSXP && Rf_isFactor(value_)) {
+    int value = INTEGER(value_)[group_];
+    if (value == NA_INTEGER) {
+      sqlite3_bind_null(stmt, j);
+    } else {
+      SEXP levels = Rf_getAttrib(value_, R_LevelsSymbol);
+      sqlite3_bind_text(stmt, j, get_utf8(STRING_ELT(levels, value - 1)), -1, SQLITE_STATIC);
+    }
+  }
   else if (TYPEOF(value_) == INTSXP) {
     int value = INTEGER(value_)[group_];
     if (value == NA_INTEGER) {
@@ -273,9 +438,12 @@ void SqliteResultImpl::bind_parameter_pos(int j, SEXP value_) {
     if (value == NA_STRING) {
       sqlite3_bind_null(stmt, j);
     } else {
-      sqlite3_bind_text(stmt, j, CHAR(value), -1, SQLITE_TRANSIENT);
+      sqlite3_bind_text(stmt, j, get_utf8(value), -1, SQLITE_STATIC);
     }
   }
+  else if (TYPEOF(value_) == VECSXP && Rf_inherits(value_, "sqlite_array")) {
+    SqliteArray::bind(stmt, j, VECTOR_ELT(value_, 0));
+  }
   else if (TYPEOF(value_) == VECSXP) {
     SEXP value = VECTOR_ELT(value_, group_);
     if (TYPEOF(value) == NILSXP) {
@@ -294,6 +462,32 @@ void SqliteResultImpl::bind_parameter_pos(int j, SEXP value_) {
   }
 }
 
+// Strings are bound without copying them: the parameters are kept in params_,
+// and strings that need translation are kept in utf8_cache_, until the next row
+// is bound.  Each distinct string in another encoding is translated only once.
+const char* SqliteResultImpl::get_utf8(SEXP x) {
+  // Bytes are bound as they are, as enc2utf8() did; translating them fails
+  const cetype_t ce = Rf_getCharCE(x);
+  if (ce == CE_UTF8 || ce == CE_BYTES)
+    return CHAR(x);
+
+  std::map<SEXP, std::string>::const_iterator it = utf8_cache_.find(x);
+  if (it != utf8_cache_.end())
+    return it->second.c_str();
+
+  const void* vmax = vmaxget();
+  const char* utf8 = Rf_translateCharUTF8(x);
+  if (utf8 == CHAR(x)) {
+    // ASCII, or native strings in a UTF-8 locale
+    vmaxset(vmax);
+    return utf8;
+  }
+
+  const char* ret = utf8_cache_.insert(std::make_pair(x, std::string(utf8))).first->second.c_str();
+  vmaxset(vmax);
+  return ret;
+}
+
 void SqliteResultImpl::after_bind(bool params_have_rows) {
   init(params_have_rows);
   if (params_have_rows)
@@ -303,16 +497,22 @@ void SqliteResultImpl::after_bind(bool params_have_rows) {
 List SqliteResultImpl::fetch_rows(const int n_max, int& n) {
   n = (n_max < 0) ? 100 : n_max;
 
-  SqliteDataFrame data(stmt, cache.names_, n_max, types_, with_alt_types_);
+  SqliteDataFrame data(stmt, cache.names_, n_max, types_, col_types_, with_alt_types_, bigint_);
 
   if (complete_ && data.get_ncols() == 0) {
     warning("SQL statements must be issued with dbExecute() or dbSendStatement() instead of dbGetQuery() or dbSendQuery().");
   }
 
+  // 1-based index of the parameter group that produced each row
+  std::vector<int> group_index;
+  const bool with_group = !group_column_.empty();
+
   while (!complete_) {
     LOG_VERBOSE << nrows_ << "/" << n;
 
     data.set_col_values();
+    if (with_group)
+      group_index.push_back(group_ + 1);
     step();
     nrows_++;
     if (!data.advance())
@@ -321,7 +521,10 @@ List SqliteResultImpl::fetch_rows(const int n_max, int& n) {
 
   LOG_VERBOSE << nrows_;
 
-  return data.get_data(types_);
+  List out = data.get_data(types_);
+  if (with_group)
+    out = add_group_column(out, group_index);
+  return out;
 }
 
 void SqliteResultImpl::step() {
@@ -345,6 +548,9 @@ bool SqliteResultImpl::step_run() {
 }
 
 bool SqliteResultImpl::step_done() {
+  if (rollback_) {
+    owner_->invalidate_schema_cache();
+  }
   ++group_;
   bool more_params = bind_row();
 
@@ -356,13 +562,35 @@ bool SqliteResultImpl::step_done() {
 }
 
 List SqliteResultImpl::peek_first_row() {
-  SqliteDataFrame data(stmt, cache.names_, 1, types_, with_alt_types_);
+  SqliteDataFrame data(stmt, cache.names_, 1, types_, col_types_, with_alt_types_, bigint_);
 
   if (!complete_)
     data.set_col_values();
   // Not calling data.advance(), remains a zero-row data frame
 
-  return data.get_data(types_);
+  List out = data.get_data(types_);
+  if (!group_column_.empty())
+    out = add_group_column(out, std::vector<int>());
+  return out;
+}
+
+List SqliteResultImpl::add_group_column(const List& data, const std::vector<int>& group_index) const {
+  const int ncols = data.size();
+  List out(ncols + 1);
+  StringVector names(ncols + 1);
+  StringVector data_names = data.attr("names");
+
+  out[0] = IntegerVector(group_index.begin(), group_index.end());
+  names[0] = String(group_column_, CE_UTF8);
+  for (int j = 0; j < ncols; ++j) {
+    out[j + 1] = data[j];
+    names[j + 1] = data_names[j];
+  }
+
+  out.attr("names") = names;
+  out.attr("class") = "data.frame";
+  out.attr("row.names") = data.attr("row.names");
+  return out;
 }
 
 void SqliteResultImpl::raise_sqlite_exception() const {
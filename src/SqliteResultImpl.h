@@ -4,6 +4,7 @@
 
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
+#include <map>
 #include "sqlite3-cpp.h"
 #include "DbColumnDataType.h"
 
@@ -12,9 +13,15 @@ typedef boost::shared_ptr<DbConnection> DbConnectionPtr;
 
 class SqliteResultImpl : public boost::noncopyable {
 private:
-  // Wrapped pointer
-  sqlite3* conn;
+  // Wrapped pointer, the statement belongs to owner_: the connection, or the
+  // reader of a pooled connection
+  DbConnection* owner_;
+  const std::string sql_;
+  bool cacheable_;
+  int generation_;
   sqlite3_stmt* stmt;
+  sqlite3* conn;
+  const bool rollback_;
 
   // Cache
   struct _cache {
@@ -34,16 +41,24 @@ private:
   int total_changes_start_;
   List params_;
   int group_, groups_;
+  std::string group_column_;
   std::vector<DATA_TYPE> types_;
+  std::vector<DATA_TYPE> col_types_;
   bool with_alt_types_;
+  DATA_TYPE bigint_;
+  std::map<SEXP, std::string> utf8_cache_;
 
 public:
   SqliteResultImpl(const DbConnectionPtr& conn_, const std::string& sql);
   ~SqliteResultImpl();
 
 private:
-  static sqlite3_stmt* prepare(sqlite3* conn, const std::string& sql);
+  sqlite3_stmt* prepare();
+  static sqlite3_stmt* prepare(sqlite3* conn, const std::string& sql, bool& has_tail);
+  static bool is_rollback(sqlite3_stmt* stmt);
   static std::vector<DATA_TYPE> get_initial_field_types(const size_t ncols);
+  static DATA_TYPE datatype_from_name(const std::string& type);
+  static DATA_TYPE bigint_from_name(const std::string& bigint);
   void init(bool params_have_rows);
 
 public:
@@ -53,16 +68,20 @@ public:
   int n_rows_affected();
   void bind(const List& params);
   List fetch(const int n_max);
+  int fetch_chunks(const int n, SEXP callback);
 
   List get_column_info();
 
 public:
   CharacterVector get_placeholder_names() const;
+  void set_group_column(const std::string& name);
+  void set_col_types(const std::vector<std::string>& names, const std::vector<std::string>& types);
 
 private:
   void set_params(const List& params);
   bool bind_row();
   void bind_parameter_pos(int j, SEXP value_);
+  const char* get_utf8(SEXP x);
   void after_bind(bool params_have_rows);
 
   List fetch_rows(int n_max, int& n);
@@ -70,6 +89,7 @@ private:
   bool step_run();
   bool step_done();
   List peek_first_row();
+  List add_group_column(const List& data, const std::vector<int>& group_index) const;
 
 private:
   void NORET raise_sqlite_exception() const;
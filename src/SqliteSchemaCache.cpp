@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "SqliteSchemaCache.h"
+
+
+// Construction ////////////////////////////////////////////////////////////////
+
+SqliteSchemaCache::SqliteSchemaCache() :
+  valid_(false),
+  generation_(0),
+  main_version_(0),
+  temp_version_(0),
+  main_version_stmt_(NULL),
+  temp_version_stmt_(NULL)
+{
+}
+
+SqliteSchemaCache::~SqliteSchemaCache() {
+  clear();
+}
+
+
+// Publics /////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> SqliteSchemaCache::list_tables(sqlite3* conn) {
+  refresh(conn);
+
+  std::vector<std::string> names;
+  names.reserve(tables_.size());
+  for (size_t i = 0; i < tables_.size(); ++i) {
+    names.push_back(tables_[i].name);
+  }
+  return names;
+}
+
+bool SqliteSchemaCache::exists_table(sqlite3* conn, const std::string& schema,
+                                     const std::string& name) {
+  refresh(conn);
+  return find_table(schema, name);
+}
+
+std::vector<std::string> SqliteSchemaCache::list_fields(sqlite3* conn, const std::string& schema,
+                                                        const std::string& name) {
+  refresh(conn);
+
+  // Identifiers are case-insensitive
+  std::string key = schema + "." + name;
+  for (size_t i = 0; i < key.size(); ++i) {
+    key[i] = static_cast<char>(tolower(static_cast<unsigned char>(key[i])));
+  }
+
+  std::map<std::string, std::vector<std::string> >::const_iterator it = fields_.find(key);
+  if (it != fields_.end()) return it->second;
+
+  char* sql = schema.empty() ?
+    sqlite3_mprintf("SELECT * FROM \"%w\"", name.c_str()) :
+    sqlite3_mprintf("SELECT * FROM \"%w\".\"%w\"", schema.c_str(), name.c_str());
+  sqlite3_stmt* stmt = NULL;
+  int rc = sqlite3_prepare_v2(conn, sql, -1, &stmt, NULL);
+  sqlite3_free(sql);
+  if (rc != SQLITE_OK) {
+    stop(sqlite3_errmsg(conn));
+  }
+
+  std::vector<std::string> fields;
+  const int ncols = sqlite3_column_count(stmt);
+  for (int j = 0; j < ncols; ++j) {
+    fields.push_back(sqlite3_column_name(stmt, j));
+  }
+  sqlite3_finalize(stmt);
+
+  // Tables of attached databases are not covered by the schema versions
+  if (valid_ && find_table(schema, name)) {
+    fields_[key] = fields;
+  }
+  return fields;
+}
+
+int SqliteSchemaCache::generation(sqlite3* conn) {
+  try {
+    refresh(conn);
+  } catch (...) {
+    return -1;
+  }
+  return generation_;
+}
+
+void SqliteSchemaCache::invalidate() {
+  valid_ = false;
+}
+
+void SqliteSchemaCache::clear() {
+  sqlite3_finalize(main_version_stmt_);
+  main_version_stmt_ = NULL;
+  sqlite3_finalize(temp_version_stmt_);
+  temp_version_stmt_ = NULL;
+
+  valid_ = false;
+  tables_.clear();
+  fields_.clear();
+}
+
+
+// Privates ////////////////////////////////////////////////////////////////////
+
+void SqliteSchemaCache::refresh(sqlite3* conn) {
+  const int main_version = schema_version(conn, main_version_stmt_, "PRAGMA main.schema_version");
+  const int temp_version = schema_version(conn, temp_version_stmt_, "PRAGMA temp.schema_version");
+  if (valid_ && main_version == main_version_ && temp_version == temp_version_) return;
+
+  valid_ = false;
+  ++generation_;
+  tables_.clear();
+  fields_.clear();
+
+  sqlite3_stmt* stmt = NULL;
+  int rc = sqlite3_prepare_v2(
+    conn,
+    "SELECT name, 0 FROM main.sqlite_master WHERE (type = 'table' OR type = 'view') "
+    "UNION ALL "
+    "SELECT name, 1 FROM temp.sqlite_master WHERE (type = 'table' OR type = 'view') "
+    "ORDER BY name",
+    -1, &stmt, NULL
+  );
+  if (rc != SQLITE_OK) {
+    stop(sqlite3_errmsg(conn));
+  }
+
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    table t;
+    t.name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    t.temp = sqlite3_column_int(stmt, 1) != 0;
+    tables_.push_back(t);
+  }
+  sqlite3_finalize(stmt);
+  if (rc != SQLITE_DONE) {
+    tables_.clear();
+    stop(sqlite3_errmsg(conn));
+  }
+
+  main_version_ = main_version;
+  temp_version_ = temp_version;
+  valid_ = true;
+}
+
+int SqliteSchemaCache::schema_version(sqlite3* conn, sqlite3_stmt*& stmt, const char* sql) {
+  if (stmt == NULL) {
+    int rc = sqlite3_prepare_v2(conn, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+      stop(sqlite3_errmsg(conn));
+    }
+  }
+
+  int rc = sqlite3_step(stmt);
+  int version = (rc == SQLITE_ROW) ? sqlite3_column_int(stmt, 0) : 0;
+  sqlite3_reset(stmt);
+  if (rc != SQLITE_ROW) {
+    stop(sqlite3_errmsg(conn));
+  }
+  return version;
+}
+
+bool SqliteSchemaCache::find_table(const std::string& schema, const std::string& name) const {
+  const bool any = schema.empty();
+  const bool temp = !any && sqlite3_stricmp(schema.c_str(), "temp") == 0;
+  if (!any && !temp && sqlite3_stricmp(schema.c_str(), "main") != 0) return false;
+
+  for (size_t i = 0; i < tables_.size(); ++i) {
+    if ((any || tables_[i].temp == temp) && sqlite3_stricmp(tables_[i].name.c_str(), name.c_str()) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
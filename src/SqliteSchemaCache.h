@@ -0,0 +1,63 @@
+#ifndef __RSQLITE_SQLITE_SCHEMA_CACHE__
+#define __RSQLITE_SQLITE_SCHEMA_CACHE__
+
+#include <boost/noncopyable.hpp>
+#include <map>
+#include <string>
+#include <vector>
+#include "sqlite3-cpp.h"
+
+// Tables and views of the main and temp schemas, and the columns of those
+// that were asked for.  The cache is checked against PRAGMA schema_version
+// of both schemas before it is used, and rebuilt when one of them changed.
+//
+// Rolling back a transaction or a savepoint restores an earlier schema
+// version, the connection invalidates the cache then.
+
+class SqliteSchemaCache : boost::noncopyable {
+public:
+  SqliteSchemaCache();
+  ~SqliteSchemaCache();
+
+public:
+  // Names of tables and views, sorted
+  std::vector<std::string> list_tables(sqlite3* conn);
+
+  // Case-insensitive; an empty schema stands for main and temp
+  bool exists_table(sqlite3* conn, const std::string& schema, const std::string& name);
+
+  // Column names of a table or view, as returned by SELECT *
+  std::vector<std::string> list_fields(sqlite3* conn, const std::string& schema,
+                                       const std::string& name);
+
+  // Changes whenever the schema of main or temp changes or the cache is
+  // invalidated; -1 if the schema versions cannot be read
+  int generation(sqlite3* conn);
+
+  // Rebuilds the cache on next use
+  void invalidate();
+
+  // Finalizes the statements, must be called before the connection is closed
+  void clear();
+
+private:
+  void refresh(sqlite3* conn);
+  int schema_version(sqlite3* conn, sqlite3_stmt*& stmt, const char* sql);
+  bool find_table(const std::string& schema, const std::string& name) const;
+
+  struct table {
+    std::string name;
+    bool temp;
+  };
+
+  bool valid_;
+  int generation_;
+  int main_version_;
+  int temp_version_;
+  sqlite3_stmt* main_version_stmt_;
+  sqlite3_stmt* temp_version_stmt_;
+  std::vector<table> tables_;
+  std::map<std::string, std::vector<std::string> > fields_;
+};
+
+#endif // __RSQLITE_SQLITE_SCHEMA_CACHE__
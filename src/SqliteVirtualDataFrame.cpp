@@ -0,0 +1,534 @@
+#include "pch.h"
+#include "SqliteVirtualDataFrame.h"
+#include "DbConnection.h"
+#include "integer64.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+
+// Orders rows by the value of a column, ties by row number
+class SqliteVirtualDataFrameLess {
+public:
+  SqliteVirtualDataFrameLess(const SqliteVirtualDataFrame::Column& col_) : col(col_) {}
+
+  bool operator()(int a, int b) const {
+    int cmp = 0;
+    switch (col.kind) {
+    case SqliteVirtualDataFrame::KIND_LOGICAL:
+    case SqliteVirtualDataFrame::KIND_INTEGER:
+    case SqliteVirtualDataFrame::KIND_FACTOR:
+      cmp = (INTEGER(col.x)[a] > INTEGER(col.x)[b]) - (INTEGER(col.x)[a] < INTEGER(col.x)[b]);
+      break;
+    case SqliteVirtualDataFrame::KIND_REAL:
+      cmp = (REAL(col.x)[a] > REAL(col.x)[b]) - (REAL(col.x)[a] < REAL(col.x)[b]);
+      break;
+    case SqliteVirtualDataFrame::KIND_INTEGER64:
+      cmp = (INTEGER64(col.x)[a] > INTEGER64(col.x)[b]) - (INTEGER64(col.x)[a] < INTEGER64(col.x)[b]);
+      break;
+    case SqliteVirtualDataFrame::KIND_STRING:
+      cmp = strcmp(CHAR(STRING_ELT(col.x, a)), CHAR(STRING_ELT(col.x, b)));
+      break;
+    case SqliteVirtualDataFrame::KIND_BLOB:
+      break;
+    }
+    return cmp < 0 || (cmp == 0 && a < b);
+  }
+
+private:
+  const SqliteVirtualDataFrame::Column& col;
+};
+
+
+SqliteVirtualDataFrame::SqliteVirtualDataFrame(SEXP data, const std::vector<std::string>& types,
+                                               const std::vector<std::string>& index) :
+  data_(data),
+  nrow_(0)
+{
+  if (TYPEOF(data) != VECSXP) stop("Can only register data frames");
+
+  SEXP names = Rf_getAttrib(data, R_NamesSymbol);
+  const int ncol = Rf_length(data);
+  if (ncol == 0) stop("Cannot register a data frame without columns");
+  if (static_cast<int>(types.size()) != ncol) stop("Need one type per column");
+
+  nrow_ = Rf_xlength(VECTOR_ELT(data, 0));
+
+  for (int j = 0; j < ncol; ++j) {
+    Column col;
+    col.x = VECTOR_ELT(data, j);
+    col.name = CHAR(STRING_ELT(names, j));
+    col.type = types[j];
+    col.levels = R_NilValue;
+    col.sorted = false;
+    col.indexed = false;
+
+    if (Rf_xlength(col.x) != nrow_) stop("All columns must have the same length");
+
+    if (TYPEOF(col.x) == LGLSXP) {
+      col.kind = KIND_LOGICAL;
+    }
+    else if (TYPEOF(col.x) == INTSXP && Rf_isFactor(col.x)) {
+      col.kind = KIND_FACTOR;
+      col.levels = Rf_getAttrib(col.x, R_LevelsSymbol);
+    }
+    else if (TYPEOF(col.x) == INTSXP) {
+      col.kind = KIND_INTEGER;
+    }
+    else if (TYPEOF(col.x) == INT64SXP && Rf_inherits(col.x, "integer64")) {
+      col.kind = KIND_INTEGER64;
+    }
+    else if (TYPEOF(col.x) == REALSXP) {
+      col.kind = KIND_REAL;
+    }
+    else if (TYPEOF(col.x) == STRSXP) {
+      col.kind = KIND_STRING;
+    }
+    else if (TYPEOF(col.x) == VECSXP) {
+      col.kind = KIND_BLOB;
+      for (R_xlen_t i = 0; i < nrow_; ++i) {
+        SEXP value = VECTOR_ELT(col.x, i);
+        if (TYPEOF(value) != NILSXP && TYPEOF(value) != RAWSXP) {
+          stop("Can only register lists of raw vectors (or NULL), column %s", col.name.c_str());
+        }
+      }
+    }
+    else {
+      stop("Don't know how to handle column %s of type %s.",
+           col.name.c_str(), Rf_type2char(TYPEOF(col.x)));
+    }
+
+    if (col.kind != KIND_BLOB) {
+      col.sorted = is_sorted(col, nrow_);
+    }
+    columns_.push_back(col);
+  }
+
+  for (size_t k = 0; k < index.size(); ++k) {
+    std::vector<Column>::iterator it = columns_.begin();
+    for (; it != columns_.end(); ++it) {
+      if (it->name == index[k]) break;
+    }
+    if (it == columns_.end()) stop("Column %s not found", index[k].c_str());
+    if (it->kind == KIND_BLOB) stop("Cannot index BLOB column %s", it->name.c_str());
+    if (it->sorted || it->indexed) continue;
+    if (nrow_ > INT_MAX) stop("Cannot index data frames with more than %d rows", INT_MAX);
+
+    it->order.reserve(nrow_);
+    for (R_xlen_t i = 0; i < nrow_; ++i) {
+      if (!is_na(*it, i)) it->order.push_back(static_cast<int>(i));
+    }
+    std::sort(it->order.begin(), it->order.end(), SqliteVirtualDataFrameLess(*it));
+    it->indexed = true;
+  }
+
+  R_PreserveObject(data_);
+}
+
+SqliteVirtualDataFrame::~SqliteVirtualDataFrame() {
+  try {
+    R_ReleaseObject(data_);
+  } catch (...) {}
+}
+
+R_xlen_t SqliteVirtualDataFrame::nrow() const {
+  return nrow_;
+}
+
+const std::vector<SqliteVirtualDataFrame::Column>& SqliteVirtualDataFrame::columns() const {
+  return columns_;
+}
+
+std::string SqliteVirtualDataFrame::schema() const {
+  std::string sql = "CREATE TABLE x(";
+  for (size_t j = 0; j < columns_.size(); ++j) {
+    if (j > 0) sql += ", ";
+    char* name = sqlite3_mprintf("\"%w\" %s", columns_[j].name.c_str(), columns_[j].type.c_str());
+    sql += name;
+    sqlite3_free(name);
+  }
+  sql += ")";
+  return sql;
+}
+
+bool SqliteVirtualDataFrame::make_key(int j, sqlite3_value* value, Key* key) const {
+  const Column& col = columns_[j];
+
+  switch (col.kind) {
+  case KIND_LOGICAL:
+  case KIND_INTEGER:
+  case KIND_INTEGER64: {
+    const int type = sqlite3_value_numeric_type(value);
+    int64_t i64;
+    if (type == SQLITE_INTEGER) {
+      i64 = sqlite3_value_int64(value);
+    }
+    else if (type == SQLITE_FLOAT) {
+      double d = sqlite3_value_double(value);
+      if (!(d >= -9.2e18 && d <= 9.2e18) || d != std::floor(d)) return false;
+      i64 = static_cast<int64_t>(d);
+    }
+    else {
+      return false;
+    }
+    if (col.kind == KIND_INTEGER64) {
+      if (i64 == NA_INTEGER64) return false;
+      key->i64 = i64;
+    }
+    else {
+      if (i64 <= INT_MIN || i64 > INT_MAX) return false;
+      key->i = static_cast<int>(i64);
+    }
+    return true;
+  }
+
+  case KIND_REAL: {
+    const int type = sqlite3_value_numeric_type(value);
+    if (type != SQLITE_INTEGER && type != SQLITE_FLOAT) return false;
+    key->d = sqlite3_value_double(value);
+    return true;
+  }
+
+  case KIND_STRING:
+  case KIND_FACTOR: {
+    // sqlite3_value_numeric_type() would convert '01' to 1 in place
+    const int type = sqlite3_value_type(value);
+    if (type == SQLITE_NULL || type == SQLITE_BLOB) return false;
+    const char* s = reinterpret_cast<const char*>(sqlite3_value_text(value));
+    if (s == NULL) return false;
+    if (col.kind == KIND_STRING) {
+      key->s = s;
+      return true;
+    }
+    const int nlevels = Rf_length(col.levels);
+    for (int k = 0; k < nlevels; ++k) {
+      if (strcmp(CHAR(STRING_ELT(col.levels, k)), s) == 0) {
+        key->i = k + 1;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  case KIND_BLOB:
+    break;
+  }
+  return false;
+}
+
+void SqliteVirtualDataFrame::equal_range(int j, const Key& key, R_xlen_t* begin, R_xlen_t* end) const {
+  const Column& col = columns_[j];
+  const R_xlen_t n = col.indexed ? static_cast<R_xlen_t>(col.order.size()) : nrow_;
+
+  R_xlen_t lo = 0, hi = n;
+  while (lo < hi) {
+    R_xlen_t mid = lo + (hi - lo) / 2;
+    R_xlen_t i = col.indexed ? col.order[mid] : mid;
+    if (compare(col, i, key) < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  *begin = lo;
+
+  hi = n;
+  while (lo < hi) {
+    R_xlen_t mid = lo + (hi - lo) / 2;
+    R_xlen_t i = col.indexed ? col.order[mid] : mid;
+    if (compare(col, i, key) <= 0) lo = mid + 1;
+    else hi = mid;
+  }
+  *end = lo;
+}
+
+void SqliteVirtualDataFrame::result(sqlite3_context* ctx, int j, R_xlen_t i) const {
+  const Column& col = columns_[j];
+
+  if (is_na(col, i)) {
+    sqlite3_result_null(ctx);
+    return;
+  }
+
+  switch (col.kind) {
+  case KIND_LOGICAL:
+  case KIND_INTEGER:
+    sqlite3_result_int(ctx, INTEGER(col.x)[i]);
+    break;
+  case KIND_FACTOR: {
+    SEXP level = STRING_ELT(col.levels, INTEGER(col.x)[i] - 1);
+    sqlite3_result_text(ctx, CHAR(level), Rf_length(level), SQLITE_STATIC);
+    break;
+  }
+  case KIND_REAL:
+    sqlite3_result_double(ctx, REAL(col.x)[i]);
+    break;
+  case KIND_INTEGER64:
+    sqlite3_result_int64(ctx, INTEGER64(col.x)[i]);
+    break;
+  case KIND_STRING: {
+    SEXP value = STRING_ELT(col.x, i);
+    sqlite3_result_text(ctx, CHAR(value), Rf_length(value), SQLITE_STATIC);
+    break;
+  }
+  case KIND_BLOB: {
+    SEXP value = VECTOR_ELT(col.x, i);
+    if (Rf_length(value) == 0) sqlite3_result_zeroblob(ctx, 0);
+    else sqlite3_result_blob(ctx, RAW(value), Rf_length(value), SQLITE_STATIC);
+    break;
+  }
+  }
+}
+
+int SqliteVirtualDataFrame::compare(const Column& col, R_xlen_t i, const Key& key) {
+  switch (col.kind) {
+  case KIND_LOGICAL:
+  case KIND_INTEGER:
+  case KIND_FACTOR:
+    return (INTEGER(col.x)[i] > key.i) - (INTEGER(col.x)[i] < key.i);
+  case KIND_REAL:
+    return (REAL(col.x)[i] > key.d) - (REAL(col.x)[i] < key.d);
+  case KIND_INTEGER64:
+    return (INTEGER64(col.x)[i] > key.i64) - (INTEGER64(col.x)[i] < key.i64);
+  case KIND_STRING:
+    return strcmp(CHAR(STRING_ELT(col.x, i)), key.s);
+  case KIND_BLOB:
+    break;
+  }
+  return 0;
+}
+
+bool SqliteVirtualDataFrame::is_na(const Column& col, R_xlen_t i) {
+  switch (col.kind) {
+  case KIND_LOGICAL:
+    return LOGICAL(col.x)[i] == NA_LOGICAL;
+  case KIND_INTEGER:
+  case KIND_FACTOR:
+    return INTEGER(col.x)[i] == NA_INTEGER;
+  case KIND_REAL:
+    return ISNAN(REAL(col.x)[i]);
+  case KIND_INTEGER64:
+    return INTEGER64(col.x)[i] == NA_INTEGER64;
+  case KIND_STRING:
+    return STRING_ELT(col.x, i) == NA_STRING;
+  case KIND_BLOB:
+    return TYPEOF(VECTOR_ELT(col.x, i)) == NILSXP;
+  }
+  return false;
+}
+
+bool SqliteVirtualDataFrame::is_sorted(const Column& col, R_xlen_t n) {
+  SqliteVirtualDataFrameLess less(col);
+  for (R_xlen_t i = 0; i < n; ++i) {
+    if (is_na(col, i)) return false;
+    if (i > 0 && less(static_cast<int>(i), static_cast<int>(i - 1))) return false;
+  }
+  return true;
+}
+
+
+// Virtual table module ------------------------------------------------------
+
+namespace {
+
+enum {
+  PLAN_SCAN = 0,  // all rows
+  PLAN_ROWID = 1, // rowid = ?
+  PLAN_EQUAL = 2  // column = ?, idxNum is PLAN_EQUAL plus the column number
+};
+
+struct DataFrameVtab {
+  sqlite3_vtab base;
+  SqliteVirtualDataFramePtr pDf;
+};
+
+struct DataFrameCursor {
+  sqlite3_vtab_cursor base;
+  R_xlen_t pos;      // current position
+  R_xlen_t end;      // end of the positions
+  const int* order;  // rows by position, NULL if the position is the row
+};
+
+inline const SqliteVirtualDataFrame& df_of(sqlite3_vtab_cursor* cur) {
+  return *reinterpret_cast<DataFrameVtab*>(cur->pVtab)->pDf;
+}
+
+inline R_xlen_t df_row(const DataFrameCursor* c) {
+  return c->order ? c->order[c->pos] : c->pos;
+}
+
+int df_connect(sqlite3* db, void* pAux, int, const char* const* argv,
+               sqlite3_vtab** ppVtab, char** pzErr) {
+  DbConnection* pConn = static_cast<DbConnection*>(pAux);
+  try {
+    SqliteVirtualDataFramePtr pDf = pConn->find_data_frame(argv[2]);
+    if (!pDf) {
+      *pzErr = sqlite3_mprintf("no data frame registered as %s", argv[2]);
+      return SQLITE_ERROR;
+    }
+
+    int rc = sqlite3_declare_vtab(db, pDf->schema().c_str());
+    if (rc != SQLITE_OK) return rc;
+
+    DataFrameVtab* p = new DataFrameVtab;
+    memset(&p->base, 0, sizeof(p->base));
+    p->pDf = pDf;
+    *ppVtab = &p->base;
+    return SQLITE_OK;
+  } catch (...) {
+    return SQLITE_NOMEM;
+  }
+}
+
+int df_disconnect(sqlite3_vtab* pVtab) {
+  delete reinterpret_cast<DataFrameVtab*>(pVtab);
+  return SQLITE_OK;
+}
+
+int df_best_index(sqlite3_vtab* pVtab, sqlite3_index_info* pInfo) {
+  const SqliteVirtualDataFrame& df = *reinterpret_cast<DataFrameVtab*>(pVtab)->pDf;
+  const std::vector<SqliteVirtualDataFrame::Column>& cols = df.columns();
+  int iRowid = -1, iEqual = -1;
+
+  for (int i = 0; i < pInfo->nConstraint; ++i) {
+    const int iColumn = pInfo->aConstraint[i].iColumn;
+    if (!pInfo->aConstraint[i].usable) continue;
+    if (pInfo->aConstraint[i].op != SQLITE_INDEX_CONSTRAINT_EQ) continue;
+    if (iColumn < 0) {
+      iRowid = i;
+      break;
+    }
+    if (iEqual < 0 && (cols[iColumn].sorted || cols[iColumn].indexed)) {
+      const char* zColl = sqlite3_vtab_collation(pInfo, i);
+      if (zColl == NULL || sqlite3_stricmp(zColl, "BINARY") == 0) iEqual = i;
+    }
+  }
+
+  if (iRowid >= 0) {
+    pInfo->idxNum = PLAN_ROWID;
+    pInfo->aConstraintUsage[iRowid].argvIndex = 1;
+    pInfo->aConstraintUsage[iRowid].omit = 1;
+    pInfo->estimatedCost = 1;
+    pInfo->estimatedRows = 1;
+    pInfo->idxFlags = SQLITE_INDEX_SCAN_UNIQUE;
+  }
+  else if (iEqual >= 0) {
+    // SQLite checks the constraint again, make_key() may be lenient
+    pInfo->idxNum = PLAN_EQUAL + pInfo->aConstraint[iEqual].iColumn;
+    pInfo->aConstraintUsage[iEqual].argvIndex = 1;
+    pInfo->estimatedCost = 1 + std::log(static_cast<double>(df.nrow()) + 1) / std::log(2.0);
+    pInfo->estimatedRows = 10;
+  }
+  else {
+    pInfo->idxNum = PLAN_SCAN;
+    pInfo->estimatedCost = static_cast<double>(df.nrow()) + 1;
+    pInfo->estimatedRows = df.nrow();
+  }
+
+  // All plans return the rows in rowid order
+  if (pInfo->nOrderBy == 1 && pInfo->aOrderBy[0].iColumn < 0 && !pInfo->aOrderBy[0].desc) {
+    pInfo->orderByConsumed = 1;
+  }
+  return SQLITE_OK;
+}
+
+int df_open(sqlite3_vtab*, sqlite3_vtab_cursor** ppCursor) {
+  DataFrameCursor* c = static_cast<DataFrameCursor*>(sqlite3_malloc(sizeof(DataFrameCursor)));
+  if (c == NULL) return SQLITE_NOMEM;
+  memset(c, 0, sizeof(*c));
+  *ppCursor = &c->base;
+  return SQLITE_OK;
+}
+
+int df_close(sqlite3_vtab_cursor* cur) {
+  sqlite3_free(cur);
+  return SQLITE_OK;
+}
+
+int df_filter(sqlite3_vtab_cursor* cur, int idxNum, const char*, int, sqlite3_value** argv) {
+  DataFrameCursor* c = reinterpret_cast<DataFrameCursor*>(cur);
+  const SqliteVirtualDataFrame& df = df_of(cur);
+
+  c->order = NULL;
+  c->pos = 0;
+  c->end = df.nrow();
+
+  if (idxNum == PLAN_ROWID) {
+    SqliteVirtualDataFrame::Key key;
+    // rowid behaves like an INTEGER64 column holding the row numbers
+    const int type = sqlite3_value_numeric_type(argv[0]);
+    double d = sqlite3_value_double(argv[0]);
+    key.i64 = sqlite3_value_int64(argv[0]);
+    if ((type != SQLITE_INTEGER && (type != SQLITE_FLOAT || d != std::floor(d))) ||
+        key.i64 < 1 || key.i64 > df.nrow()) {
+      c->end = 0;
+    }
+    else {
+      c->pos = static_cast<R_xlen_t>(key.i64) - 1;
+      c->end = c->pos + 1;
+    }
+  }
+  else if (idxNum >= PLAN_EQUAL) {
+    const int j = idxNum - PLAN_EQUAL;
+    const SqliteVirtualDataFrame::Column& col = df.columns()[j];
+    SqliteVirtualDataFrame::Key key;
+    if (!df.make_key(j, argv[0], &key)) {
+      c->end = 0;
+    }
+    else {
+      df.equal_range(j, key, &c->pos, &c->end);
+      if (col.indexed) c->order = &col.order[0];
+    }
+  }
+  return SQLITE_OK;
+}
+
+int df_next(sqlite3_vtab_cursor* cur) {
+  reinterpret_cast<DataFrameCursor*>(cur)->pos++;
+  return SQLITE_OK;
+}
+
+int df_eof(sqlite3_vtab_cursor* cur) {
+  const DataFrameCursor* c = reinterpret_cast<DataFrameCursor*>(cur);
+  return c->pos >= c->end;
+}
+
+int df_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int j) {
+  df_of(cur).result(ctx, j, df_row(reinterpret_cast<DataFrameCursor*>(cur)));
+  return SQLITE_OK;
+}
+
+int df_rowid(sqlite3_vtab_cursor* cur, sqlite_int64* pRowid) {
+  *pRowid = df_row(reinterpret_cast<DataFrameCursor*>(cur)) + 1;
+  return SQLITE_OK;
+}
+
+sqlite3_module df_module = {
+  0,              // iVersion
+  df_connect,     // xCreate
+  df_connect,     // xConnect
+  df_best_index,  // xBestIndex
+  df_disconnect,  // xDisconnect
+  df_disconnect,  // xDestroy
+  df_open,        // xOpen
+  df_close,       // xClose
+  df_filter,      // xFilter
+  df_next,        // xNext
+  df_eof,         // xEof
+  df_column,      // xColumn
+  df_rowid,       // xRowid
+  NULL,           // xUpdate, read-only
+  NULL,           // xBegin
+  NULL,           // xSync
+  NULL,           // xCommit
+  NULL,           // xRollback
+  NULL,           // xFindFunction
+  NULL,           // xRename
+  NULL,           // xSavepoint
+  NULL,           // xRelease
+  NULL,           // xRollbackTo
+  NULL            // xShadowName
+};
+
+}
+
+int SqliteVirtualDataFrame::register_module(sqlite3* conn, DbConnection* pConn) {
+  return sqlite3_create_module_v2(conn, "rdataframe", &df_module, pConn, NULL);
+}
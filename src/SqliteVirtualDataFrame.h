@@ -0,0 +1,87 @@
+#ifndef __RSQLITE_SQLITE_VIRTUAL_DATA_FRAME__
+#define __RSQLITE_SQLITE_VIRTUAL_DATA_FRAME__
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include "sqlite3-cpp.h"
+
+class DbConnection;
+
+// A data frame that is exposed as a read-only table through the
+// "rdataframe" virtual table module.  Values are read directly from the
+// R vectors, which are protected as long as this object is alive.
+// Columns that are sorted, or that are listed in `index`, support equality
+// lookups by binary search.
+
+class SqliteVirtualDataFrame : boost::noncopyable {
+public:
+  enum Kind {
+    KIND_LOGICAL,
+    KIND_INTEGER,
+    KIND_FACTOR,
+    KIND_REAL,
+    KIND_INTEGER64,
+    KIND_STRING,
+    KIND_BLOB
+  };
+
+  struct Column {
+    SEXP x;
+    Kind kind;
+    std::string name;
+    std::string type;
+    SEXP levels;            // factor levels
+    bool sorted;            // ascending without missing values
+    bool indexed;           // order holds the rows sorted by value
+    std::vector<int> order; // rows without missing values, sorted by value
+  };
+
+  // Key for equality lookups, only the member for the column kind is used
+  struct Key {
+    int i;
+    double d;
+    int64_t i64;
+    const char* s;
+  };
+
+public:
+  SqliteVirtualDataFrame(SEXP data, const std::vector<std::string>& types,
+                         const std::vector<std::string>& index);
+  ~SqliteVirtualDataFrame();
+
+public:
+  R_xlen_t nrow() const;
+  const std::vector<Column>& columns() const;
+
+  // CREATE TABLE statement for sqlite3_declare_vtab()
+  std::string schema() const;
+
+  // Converts a value to the key for an equality lookup in a column,
+  // returns false if no row can be equal to the value
+  bool make_key(int j, sqlite3_value* value, Key* key) const;
+
+  // Range of positions [*begin, *end) in the order of column j that hold
+  // the key; rows are positions for sorted columns and order[positions]
+  // for indexed columns
+  void equal_range(int j, const Key& key, R_xlen_t* begin, R_xlen_t* end) const;
+
+  // Sets the result of the SQL function to the value in column j, row i
+  void result(sqlite3_context* ctx, int j, R_xlen_t i) const;
+
+  // Registers the "rdataframe" module, tables are looked up by name
+  // in the data frames registered with the connection
+  static int register_module(sqlite3* conn, DbConnection* pConn);
+
+private:
+  SEXP data_;
+  R_xlen_t nrow_;
+  std::vector<Column> columns_;
+
+  static int compare(const Column& col, R_xlen_t i, const Key& key);
+  static bool is_na(const Column& col, R_xlen_t i);
+  static bool is_sorted(const Column& col, R_xlen_t n);
+};
+
+typedef boost::shared_ptr<SqliteVirtualDataFrame> SqliteVirtualDataFramePtr;
+
+#endif // __RSQLITE_SQLITE_VIRTUAL_DATA_FRAME__
@@ -0,0 +1,37 @@
+#include "pch.h"
+#include "DbBackup.h"
+
+// [[Rcpp::export]]
+XPtr<DbBackup> backup_init(const XPtr<DbConnectionPtr>& from, const XPtr<DbConnectionPtr>& to) {
+  DbBackup* backup = new DbBackup(*from, *to);
+  return XPtr<DbBackup>(backup, true);
+}
+
+// [[Rcpp::export]]
+void backup_release(XPtr<DbBackup> backup) {
+  backup.release();
+}
+
+// [[Rcpp::export]]
+void backup_run(XPtr<DbBackup> backup, const int pages, const int sleep_ms, SEXP progress) {
+  backup->run(pages, sleep_ms, progress);
+}
+
+// [[Rcpp::export]]
+void backup_start(XPtr<DbBackup> backup, const int pages, const int sleep_ms) {
+  backup->start(pages, sleep_ms);
+}
+
+// [[Rcpp::export]]
+List backup_progress(XPtr<DbBackup> backup) {
+  return List::create(
+    _["running"] = backup->is_running(),
+    _["remaining"] = backup->remaining(),
+    _["pagecount"] = backup->pagecount()
+  );
+}
+
+// [[Rcpp::export]]
+void backup_wait(XPtr<DbBackup> backup) {
+  backup->wait();
+}
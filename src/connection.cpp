@@ -14,12 +14,13 @@ extern "C" {
 
 // [[Rcpp::export]]
 XPtr<DbConnectionPtr> connection_connect(
-  const std::string& path, const bool allow_ext, const int flags, const std::string& vfs = "", bool with_alt_types = false
+  const std::string& path, const bool allow_ext, const int flags, const std::string& vfs = "", bool with_alt_types = false,
+  const std::string& bigint = "integer64"
 ) {
   LOG_VERBOSE;
 
   DbConnectionPtr* pConn = new DbConnectionPtr(
-    new DbConnection(path, allow_ext, flags, vfs, with_alt_types)
+    new DbConnection(path, allow_ext, flags, vfs, with_alt_types, bigint)
   );
 
   return XPtr<DbConnectionPtr>(pConn, true);
@@ -59,12 +60,6 @@ void connection_release(XPtr<DbConnectionPtr> con_) {
 
 // Specific functions
 
-// [[Rcpp::export]]
-void connection_copy_database(const XPtr<DbConnectionPtr>& from,
-                              const XPtr<DbConnectionPtr>& to) {
-  (*from)->copy_to((*to));
-}
-
 // [[Rcpp::export]]
 bool connection_import_file(const XPtr<DbConnectionPtr>& con,
                             const std::string& name, const std::string& value,
@@ -92,3 +87,70 @@ DbConnection* as(SEXP x) {
 void set_busy_handler(const XPtr<DbConnectionPtr>& con, SEXP r_callback) {
   con->get()->set_busy_handler(r_callback);
 }
+
+// [[Rcpp::export]]
+void connection_register_data_frame(const XPtr<DbConnectionPtr>& con, const std::string& name,
+                                    SEXP value, std::vector<std::string> types,
+                                    std::vector<std::string> index) {
+  con->get()->register_data_frame(name, value, types, index);
+}
+
+// [[Rcpp::export]]
+void connection_unregister_data_frame(const XPtr<DbConnectionPtr>& con, const std::string& name) {
+  con->get()->unregister_data_frame(name);
+}
+
+// [[Rcpp::export]]
+RawVector connection_serialize(const XPtr<DbConnectionPtr>& con, const std::string& schema) {
+  return con->get()->serialize(schema);
+}
+
+// [[Rcpp::export]]
+void connection_deserialize(const XPtr<DbConnectionPtr>& con, const std::string& schema,
+                            SEXP data, const bool read_only) {
+  con->get()->deserialize(schema, data, read_only);
+}
+
+// [[Rcpp::export]]
+List connection_vfs_stats(const XPtr<DbConnectionPtr>& con, const std::string& schema,
+                          const bool reset) {
+  return con->get()->vfs_stats(schema, reset);
+}
+
+// [[Rcpp::export]]
+void connection_create_function(const XPtr<DbConnectionPtr>& con, const std::string& name,
+                                SEXP fun, const int n_arg, const bool aggregate,
+                                const bool deterministic, const int cache_size) {
+  con->get()->create_function(name, fun, n_arg, aggregate, deterministic, cache_size);
+}
+
+// [[Rcpp::export]]
+void connection_remove_function(const XPtr<DbConnectionPtr>& con, const std::string& name,
+                                const int n_arg) {
+  con->get()->remove_function(name, n_arg);
+}
+
+static CharacterVector utf8_strings(const std::vector<std::string>& x) {
+  CharacterVector out(x.size());
+  for (size_t i = 0; i < x.size(); ++i) {
+    SET_STRING_ELT(out, i, Rf_mkCharCE(x[i].c_str(), CE_UTF8));
+  }
+  return out;
+}
+
+// [[Rcpp::export]]
+CharacterVector connection_list_tables(const XPtr<DbConnectionPtr>& con) {
+  return utf8_strings(con->get()->list_tables());
+}
+
+// [[Rcpp::export]]
+bool connection_exists_table(const XPtr<DbConnectionPtr>& con, const std::string& schema,
+                             const std::string& name) {
+  return con->get()->exists_table(schema, name);
+}
+
+// [[Rcpp::export]]
+CharacterVector connection_list_fields(const XPtr<DbConnectionPtr>& con, const std::string& schema,
+                                       const std::string& name) {
+  return utf8_strings(con->get()->list_fields(schema, name));
+}
@@ -1,5 +1,6 @@
 #define SQLITE_CORE
-#include <R_ext/Visibility.h>
-#define sqlite3_csv_init attribute_visible sqlite3_csv_init
 
+// File obtained from https://sqlite.org/src/file?filename=ext/misc/csv.c
+// and extended with column projection, typed columns and a row-offset index.
+// Removed from upgrade.R, changes from upstream must be merged manually.
 #include "vendor/extensions/csv.c"
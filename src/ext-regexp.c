@@ -1,5 +1,6 @@
 #define SQLITE_CORE
-#include <R_ext/Visibility.h>
-#define sqlite3_regexp_init attribute_visible sqlite3_regexp_init
 
+// File obtained from https://sqlite.org/src/file?filename=ext/misc/regexp.c
+// and extended with a required-literal prefilter and a cached lazy DFA.
+// Removed from upgrade.R, changes from upstream must be merged manually.
 #include "vendor/extensions/regexp.c"
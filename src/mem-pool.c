@@ -0,0 +1,239 @@
+/*
+ * A size-class pool allocator for SQLite.
+ *
+ * Requests of up to 4096 bytes are rounded up to the next power of two and
+ * served from a free list per size class.  Empty free lists are refilled by
+ * carving a slab of 64 KiB into blocks of that class.  Freed blocks go back
+ * to their free list, slabs are only returned to the system when SQLite
+ * shuts down.  Many short-lived connections then reuse the same blocks
+ * instead of fragmenting the heap of the process.
+ *
+ * Each block starts with an 8-byte header that holds its usable size, which
+ * also tells whether it belongs to a size class or to the system allocator.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "vendor/sqlite3/sqlite3.h"
+#include "mem-pool.h"
+
+typedef sqlite3_int64 i64;
+
+#define POOL_HEADER     8
+#define POOL_SLAB_SIZE  65536
+
+typedef struct PoolBlock PoolBlock;
+struct PoolBlock {
+  PoolBlock* pNext;
+};
+
+typedef struct PoolSlab PoolSlab;
+struct PoolSlab {
+  PoolSlab* pNext;
+  i64 padding;              /* Keeps the blocks 8-byte aligned */
+};
+
+static struct {
+  int isInstalled;
+  PoolBlock* apFree[RSQLITE_POOL_NCLASS];
+  PoolSlab* pSlabs;
+  RSQLite_pool_stats stats;
+} pool;
+
+/* Protects pool, SQLite serializes calls only if SQLITE_CONFIG_MEMSTATUS */
+static sqlite3_mutex* poolMutex(void) {
+  return sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_APP1);
+}
+
+static int poolClass(int n) {
+  int iClass = 0;
+  int sz = RSQLITE_POOL_MIN_SIZE;
+  while (sz < n) {
+    sz *= 2;
+    iClass++;
+  }
+  return iClass;
+}
+
+static int poolClassSize(int iClass) {
+  return RSQLITE_POOL_MIN_SIZE << iClass;
+}
+
+static void poolCount(RSQLite_pool_counts* c, int nBytes) {
+  c->nAlloc++;
+  c->nInUse++;
+  c->nBytesInUse += nBytes;
+  if (c->nInUse > c->mxInUse) c->mxInUse = c->nInUse;
+  if (c->nBytesInUse > c->mxBytesInUse) c->mxBytesInUse = c->nBytesInUse;
+}
+
+static void poolUncount(RSQLite_pool_counts* c, int nBytes) {
+  c->nInUse--;
+  c->nBytesInUse -= nBytes;
+}
+
+/* Carves a new slab into blocks of a size class, with the mutex held */
+static int poolRefill(int iClass) {
+  const int nBlock = POOL_HEADER + poolClassSize(iClass);
+  PoolSlab* pSlab = malloc(POOL_SLAB_SIZE);
+  char* p;
+  char* pEnd;
+
+  if (pSlab == NULL) return SQLITE_NOMEM;
+  pSlab->pNext = pool.pSlabs;
+  pool.pSlabs = pSlab;
+
+  p = (char*)(pSlab + 1);
+  pEnd = (char*)pSlab + POOL_SLAB_SIZE;
+  for (; p + nBlock <= pEnd; p += nBlock) {
+    PoolBlock* pBlock = (PoolBlock*)(p + POOL_HEADER);
+    *(i64*)p = poolClassSize(iClass);
+    pBlock->pNext = pool.apFree[iClass];
+    pool.apFree[iClass] = pBlock;
+    pool.stats.aClass[iClass].nReserved++;
+  }
+  return SQLITE_OK;
+}
+
+static void* poolMalloc(int n) {
+  void* pRet = NULL;
+
+  if (n <= 0) return NULL;
+
+  if (n > RSQLITE_POOL_MAX_SIZE) {
+    char* p = malloc(POOL_HEADER + (size_t)n);
+    if (p == NULL) return NULL;
+    *(i64*)p = n;
+    sqlite3_mutex_enter(poolMutex());
+    poolCount(&pool.stats.aClass[RSQLITE_POOL_NCLASS], n);
+    sqlite3_mutex_leave(poolMutex());
+    return p + POOL_HEADER;
+  }
+  else {
+    const int iClass = poolClass(n);
+    sqlite3_mutex_enter(poolMutex());
+    if (pool.apFree[iClass] != NULL || poolRefill(iClass) == SQLITE_OK) {
+      PoolBlock* pBlock = pool.apFree[iClass];
+      pool.apFree[iClass] = pBlock->pNext;
+      poolCount(&pool.stats.aClass[iClass], poolClassSize(iClass));
+      pRet = pBlock;
+    }
+    sqlite3_mutex_leave(poolMutex());
+    return pRet;
+  }
+}
+
+static int poolSize(void* p) {
+  if (p == NULL) return 0;
+  return (int)*(i64*)((char*)p - POOL_HEADER);
+}
+
+static void poolFree(void* p) {
+  int sz;
+
+  if (p == NULL) return;
+
+  sz = poolSize(p);
+  if (sz > RSQLITE_POOL_MAX_SIZE) {
+    sqlite3_mutex_enter(poolMutex());
+    poolUncount(&pool.stats.aClass[RSQLITE_POOL_NCLASS], sz);
+    sqlite3_mutex_leave(poolMutex());
+    free((char*)p - POOL_HEADER);
+  }
+  else {
+    const int iClass = poolClass(sz);
+    PoolBlock* pBlock = (PoolBlock*)p;
+    sqlite3_mutex_enter(poolMutex());
+    pBlock->pNext = pool.apFree[iClass];
+    pool.apFree[iClass] = pBlock;
+    poolUncount(&pool.stats.aClass[iClass], sz);
+    sqlite3_mutex_leave(poolMutex());
+  }
+}
+
+static void* poolRealloc(void* p, int n) {
+  const int sz = poolSize(p);
+  void* pNew;
+
+  /* Stays in its size class */
+  if (sz <= RSQLITE_POOL_MAX_SIZE && n <= sz && n > sz / 2) return p;
+
+  if (sz > RSQLITE_POOL_MAX_SIZE && n > RSQLITE_POOL_MAX_SIZE) {
+    RSQLite_pool_counts* c = &pool.stats.aClass[RSQLITE_POOL_NCLASS];
+    char* q = realloc((char*)p - POOL_HEADER, POOL_HEADER + (size_t)n);
+    if (q == NULL) return NULL;
+    *(i64*)q = n;
+    sqlite3_mutex_enter(poolMutex());
+    c->nBytesInUse += n - sz;
+    if (c->nBytesInUse > c->mxBytesInUse) c->mxBytesInUse = c->nBytesInUse;
+    sqlite3_mutex_leave(poolMutex());
+    return q + POOL_HEADER;
+  }
+
+  pNew = poolMalloc(n);
+  if (pNew == NULL) return NULL;
+  memcpy(pNew, p, sz < n ? sz : n);
+  poolFree(p);
+  return pNew;
+}
+
+static int poolRoundup(int n) {
+  if (n > RSQLITE_POOL_MAX_SIZE) return (n + 7) & ~7;
+  return poolClassSize(poolClass(n));
+}
+
+static int poolInit(void* pAppData) {
+  (void)pAppData;
+  return SQLITE_OK;
+}
+
+static void poolShutdown(void* pAppData) {
+  (void)pAppData;
+  while (pool.pSlabs != NULL) {
+    PoolSlab* pNext = pool.pSlabs->pNext;
+    free(pool.pSlabs);
+    pool.pSlabs = pNext;
+  }
+  memset(pool.apFree, 0, sizeof(pool.apFree));
+  memset(&pool.stats, 0, sizeof(pool.stats));
+}
+
+int RSQLite_install_mem_pool(void) {
+  static const sqlite3_mem_methods methods = {
+    poolMalloc,
+    poolFree,
+    poolRealloc,
+    poolSize,
+    poolRoundup,
+    poolInit,
+    poolShutdown,
+    NULL
+  };
+  int rc;
+
+  if (pool.isInstalled) return SQLITE_OK;
+
+  rc = sqlite3_config(SQLITE_CONFIG_MALLOC, &methods);
+  if (rc == SQLITE_OK) pool.isInstalled = 1;
+  return rc;
+}
+
+int RSQLite_mem_pool_installed(void) {
+  return pool.isInstalled;
+}
+
+void RSQLite_mem_pool_stats(RSQLite_pool_stats* pStats, int bReset) {
+  int i;
+
+  sqlite3_mutex_enter(poolMutex());
+  *pStats = pool.stats;
+  if (bReset) {
+    for (i = 0; i <= RSQLITE_POOL_NCLASS; i++) {
+      RSQLite_pool_counts* c = &pool.stats.aClass[i];
+      c->nAlloc = 0;
+      c->mxInUse = c->nInUse;
+      c->mxBytesInUse = c->nBytesInUse;
+    }
+  }
+  sqlite3_mutex_leave(poolMutex());
+}
@@ -0,0 +1,51 @@
+#ifndef __RSQLITE_MEM_POOL_H
+#define __RSQLITE_MEM_POOL_H
+
+// Requires sqlite3.h, included through sqlite3-cpp.h in C++ code
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A size-class pool allocator for SQLite.  Allocations of up to
+ * RSQLITE_POOL_MAX_SIZE bytes are served from free lists of blocks of the
+ * same size, carved from slabs that are kept until SQLite shuts down.
+ * Larger allocations use the system allocator.
+ */
+
+/* Installs the allocator with sqlite3_config(SQLITE_CONFIG_MALLOC),
+ * must be called before SQLite is initialized
+ */
+int RSQLite_install_mem_pool(void);
+
+/* Is the allocator installed? */
+int RSQLite_mem_pool_installed(void);
+
+/* Size classes: 16, 32, ..., 4096 bytes, then the system allocator */
+#define RSQLITE_POOL_NCLASS    9
+#define RSQLITE_POOL_MIN_SIZE  16
+#define RSQLITE_POOL_MAX_SIZE  4096
+
+typedef struct RSQLite_pool_counts RSQLite_pool_counts;
+struct RSQLite_pool_counts {
+  sqlite3_int64 nAlloc;        /* Allocations since the last reset */
+  sqlite3_int64 nInUse;        /* Blocks in use */
+  sqlite3_int64 mxInUse;       /* High-water mark of nInUse */
+  sqlite3_int64 nBytesInUse;   /* Bytes in use */
+  sqlite3_int64 mxBytesInUse;  /* High-water mark of nBytesInUse */
+  sqlite3_int64 nReserved;     /* Blocks carved from slabs, 0 for the system */
+};
+
+typedef struct RSQLite_pool_stats RSQLite_pool_stats;
+struct RSQLite_pool_stats {
+  RSQLite_pool_counts aClass[RSQLITE_POOL_NCLASS + 1];  /* Last: system */
+};
+
+/* Copies the counters, optionally resets the totals and high-water marks */
+void RSQLite_mem_pool_stats(RSQLite_pool_stats* pStats, int bReset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RSQLITE_MEM_POOL_H
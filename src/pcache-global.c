@@ -0,0 +1,367 @@
+/*
+ * A page cache with one memory budget for all connections.
+ *
+ * Each pager still has its own cache: SQLite owns the contents of a page
+ * and the extra data that it keeps with it, so pages cannot be shared
+ * between connections through the page cache interface.  What is shared is
+ * the memory: the unpinned pages of all caches of file databases are kept
+ * in one list, most recently used first, and pages from its tail are freed
+ * when the pages of all caches together exceed the budget.
+ *
+ * Caches of in-memory databases (bPurgeable == 0) must keep all pages, they
+ * are not counted against the budget and never evicted.
+ */
+
+#include <string.h>
+#include "vendor/sqlite3/sqlite3.h"
+#include "pcache.h"
+
+typedef sqlite3_int64 i64;
+
+typedef struct GCache GCache;
+typedef struct GPage GPage;
+
+struct GPage {
+  sqlite3_pcache_page page;  /* Must be first */
+  unsigned int iKey;
+  int isPinned;
+  GCache* pCache;
+  GPage* pNext;              /* Hash chain */
+  GPage* pLruNext;           /* Unpinned pages of purgeable caches */
+  GPage* pLruPrev;
+};
+
+struct GCache {
+  int szPage;
+  int szExtra;
+  int bPurgeable;
+  unsigned int nHash;
+  unsigned int nPage;
+  GPage** apHash;
+};
+
+static struct {
+  int isInstalled;
+  GPage* pLruHead;           /* Most recently used */
+  GPage* pLruTail;
+  RSQLite_pcache_stats stats;
+} gcache;
+
+/* Protects gcache and all caches, they share the LRU list */
+static sqlite3_mutex* gcMutex(void) {
+  return sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_APP2);
+}
+
+static int gcPageSize(const GCache* pCache) {
+  return (int)sizeof(GPage) + pCache->szPage + pCache->szExtra;
+}
+
+
+/* Lists, with the mutex held ***********************************************/
+
+static void gcLruUnlink(GPage* p) {
+  if (p->pLruPrev) p->pLruPrev->pLruNext = p->pLruNext;
+  else gcache.pLruHead = p->pLruNext;
+  if (p->pLruNext) p->pLruNext->pLruPrev = p->pLruPrev;
+  else gcache.pLruTail = p->pLruPrev;
+  p->pLruNext = p->pLruPrev = NULL;
+}
+
+static void gcLruPush(GPage* p) {
+  p->pLruPrev = NULL;
+  p->pLruNext = gcache.pLruHead;
+  if (gcache.pLruHead) gcache.pLruHead->pLruPrev = p;
+  gcache.pLruHead = p;
+  if (gcache.pLruTail == NULL) gcache.pLruTail = p;
+}
+
+static GPage* gcLookup(GCache* pCache, unsigned int iKey) {
+  GPage* p;
+  if (pCache->nHash == 0) return NULL;
+  for (p = pCache->apHash[iKey % pCache->nHash]; p; p = p->pNext) {
+    if (p->iKey == iKey) return p;
+  }
+  return NULL;
+}
+
+static void gcHashRemove(GPage* p) {
+  GCache* pCache = p->pCache;
+  GPage** pp = &pCache->apHash[p->iKey % pCache->nHash];
+  while (*pp != p) pp = &(*pp)->pNext;
+  *pp = p->pNext;
+}
+
+static void gcHashInsert(GPage* p) {
+  GCache* pCache = p->pCache;
+  unsigned int h = p->iKey % pCache->nHash;
+  p->pNext = pCache->apHash[h];
+  pCache->apHash[h] = p;
+}
+
+/* Grows the hash table when it is full, failures are not fatal */
+static void gcHashResize(GCache* pCache) {
+  unsigned int nNew = pCache->nHash ? pCache->nHash * 2 : 256;
+  GPage** apNew;
+  unsigned int i;
+
+  if (pCache->nPage < pCache->nHash) return;
+
+  apNew = sqlite3_malloc64(nNew * sizeof(GPage*));
+  if (apNew == NULL) return;
+  memset(apNew, 0, nNew * sizeof(GPage*));
+
+  for (i = 0; i < pCache->nHash; i++) {
+    GPage* p = pCache->apHash[i];
+    while (p) {
+      GPage* pNext = p->pNext;
+      unsigned int h = p->iKey % nNew;
+      p->pNext = apNew[h];
+      apNew[h] = p;
+      p = pNext;
+    }
+  }
+  sqlite3_free(pCache->apHash);
+  pCache->apHash = apNew;
+  pCache->nHash = nNew;
+}
+
+static void gcFreePage(GPage* p) {
+  GCache* pCache = p->pCache;
+
+  gcHashRemove(p);
+  pCache->nPage--;
+  if (pCache->bPurgeable) {
+    if (!p->isPinned) gcLruUnlink(p);
+    gcache.stats.nPage--;
+    gcache.stats.nBytes -= gcPageSize(pCache);
+  }
+  sqlite3_free(p);
+}
+
+/* Evicts pages until nNeeded more bytes fit into the budget,
+ * returns 0 if they do not fit
+ */
+static int gcMakeRoom(i64 nNeeded) {
+  while (gcache.stats.nBytes + nNeeded > gcache.stats.nBudget) {
+    if (gcache.pLruTail == NULL) return 0;
+    gcFreePage(gcache.pLruTail);
+    gcache.stats.nEvict++;
+  }
+  return 1;
+}
+
+
+/* Methods ******************************************************************/
+
+static int gcInit(void* pArg) {
+  (void)pArg;
+  return SQLITE_OK;
+}
+
+static void gcShutdown(void* pArg) {
+  (void)pArg;
+}
+
+static sqlite3_pcache* gcCreate(int szPage, int szExtra, int bPurgeable) {
+  GCache* pCache = sqlite3_malloc(sizeof(GCache));
+  if (pCache == NULL) return NULL;
+  memset(pCache, 0, sizeof(GCache));
+  pCache->szPage = szPage;
+  pCache->szExtra = szExtra;
+  pCache->bPurgeable = bPurgeable;
+
+  sqlite3_mutex_enter(gcMutex());
+  gcache.stats.nCache++;
+  sqlite3_mutex_leave(gcMutex());
+  return (sqlite3_pcache*)pCache;
+}
+
+static void gcCachesize(sqlite3_pcache* pc, int nCachesize) {
+  /* The budget applies instead */
+  (void)pc;
+  (void)nCachesize;
+}
+
+static int gcPagecount(sqlite3_pcache* pc) {
+  GCache* pCache = (GCache*)pc;
+  int n;
+  sqlite3_mutex_enter(gcMutex());
+  n = (int)pCache->nPage;
+  sqlite3_mutex_leave(gcMutex());
+  return n;
+}
+
+static sqlite3_pcache_page* gcFetch(sqlite3_pcache* pc, unsigned int iKey, int createFlag) {
+  GCache* pCache = (GCache*)pc;
+  const int szAlloc = gcPageSize(pCache);
+  GPage* p;
+
+  sqlite3_mutex_enter(gcMutex());
+
+  p = gcLookup(pCache, iKey);
+  if (p != NULL) {
+    if (!p->isPinned) {
+      if (pCache->bPurgeable) gcLruUnlink(p);
+      p->isPinned = 1;
+    }
+    if (pCache->bPurgeable) gcache.stats.nHit++;
+    sqlite3_mutex_leave(gcMutex());
+    return &p->page;
+  }
+
+  /* With createFlag == 1, only if that is easy; with 2, even over budget */
+  if (createFlag == 0 ||
+      (pCache->bPurgeable && !gcMakeRoom(szAlloc) && createFlag == 1)) {
+    sqlite3_mutex_leave(gcMutex());
+    return NULL;
+  }
+
+  p = sqlite3_malloc(szAlloc);
+  if (p == NULL) {
+    sqlite3_mutex_leave(gcMutex());
+    return NULL;
+  }
+  memset(p, 0, sizeof(GPage));
+  p->page.pBuf = (void*)(p + 1);
+  p->page.pExtra = (char*)p->page.pBuf + pCache->szPage;
+  memset(p->page.pExtra, 0, pCache->szExtra);
+  p->iKey = iKey;
+  p->isPinned = 1;
+  p->pCache = pCache;
+
+  gcHashResize(pCache);
+  if (pCache->nHash == 0) {
+    sqlite3_free(p);
+    sqlite3_mutex_leave(gcMutex());
+    return NULL;
+  }
+  gcHashInsert(p);
+  pCache->nPage++;
+
+  if (pCache->bPurgeable) {
+    gcache.stats.nMiss++;
+    gcache.stats.nPage++;
+    gcache.stats.nBytes += szAlloc;
+    if (gcache.stats.nBytes > gcache.stats.mxBytes) {
+      gcache.stats.mxBytes = gcache.stats.nBytes;
+    }
+  }
+
+  sqlite3_mutex_leave(gcMutex());
+  return &p->page;
+}
+
+static void gcUnpin(sqlite3_pcache* pc, sqlite3_pcache_page* pPg, int reuseUnlikely) {
+  GCache* pCache = (GCache*)pc;
+  GPage* p = (GPage*)pPg;
+
+  sqlite3_mutex_enter(gcMutex());
+  if (reuseUnlikely) {
+    gcFreePage(p);
+  }
+  else {
+    p->isPinned = 0;
+    if (pCache->bPurgeable) {
+      gcLruPush(p);
+      gcMakeRoom(0);
+    }
+  }
+  sqlite3_mutex_leave(gcMutex());
+}
+
+static void gcRekey(sqlite3_pcache* pc, sqlite3_pcache_page* pPg,
+                    unsigned int iOld, unsigned int iNew) {
+  GCache* pCache = (GCache*)pc;
+  GPage* p = (GPage*)pPg;
+  GPage* pOther;
+  (void)iOld;
+
+  sqlite3_mutex_enter(gcMutex());
+  pOther = gcLookup(pCache, iNew);
+  if (pOther != NULL) gcFreePage(pOther);
+  gcHashRemove(p);
+  p->iKey = iNew;
+  gcHashInsert(p);
+  sqlite3_mutex_leave(gcMutex());
+}
+
+/* Discards pages with keys of at least iLimit, or all unpinned pages */
+static void gcDiscard(GCache* pCache, unsigned int iLimit, int bUnpinnedOnly) {
+  unsigned int i;
+  for (i = 0; i < pCache->nHash; i++) {
+    GPage* p = pCache->apHash[i];
+    while (p) {
+      GPage* pNext = p->pNext;
+      if (bUnpinnedOnly ? !p->isPinned : p->iKey >= iLimit) gcFreePage(p);
+      p = pNext;
+    }
+  }
+}
+
+static void gcTruncate(sqlite3_pcache* pc, unsigned int iLimit) {
+  sqlite3_mutex_enter(gcMutex());
+  gcDiscard((GCache*)pc, iLimit, 0);
+  sqlite3_mutex_leave(gcMutex());
+}
+
+static void gcShrink(sqlite3_pcache* pc) {
+  sqlite3_mutex_enter(gcMutex());
+  gcDiscard((GCache*)pc, 0, 1);
+  sqlite3_mutex_leave(gcMutex());
+}
+
+static void gcDestroy(sqlite3_pcache* pc) {
+  GCache* pCache = (GCache*)pc;
+
+  sqlite3_mutex_enter(gcMutex());
+  gcDiscard(pCache, 0, 0);
+  gcache.stats.nCache--;
+  sqlite3_mutex_leave(gcMutex());
+
+  sqlite3_free(pCache->apHash);
+  sqlite3_free(pCache);
+}
+
+int RSQLite_install_global_pcache(sqlite3_int64 nBudget) {
+  static const sqlite3_pcache_methods2 methods = {
+    1,
+    NULL,
+    gcInit,
+    gcShutdown,
+    gcCreate,
+    gcCachesize,
+    gcPagecount,
+    gcFetch,
+    gcUnpin,
+    gcRekey,
+    gcTruncate,
+    gcDestroy,
+    gcShrink
+  };
+  int rc;
+
+  if (gcache.isInstalled) return SQLITE_OK;
+
+  rc = sqlite3_config(SQLITE_CONFIG_PCACHE2, &methods);
+  if (rc == SQLITE_OK) {
+    gcache.isInstalled = 1;
+    gcache.stats.nBudget = nBudget;
+  }
+  return rc;
+}
+
+int RSQLite_global_pcache_installed(void) {
+  return gcache.isInstalled;
+}
+
+void RSQLite_global_pcache_stats(RSQLite_pcache_stats* pStats, int bReset) {
+  sqlite3_mutex_enter(gcMutex());
+  *pStats = gcache.stats;
+  if (bReset) {
+    gcache.stats.nHit = 0;
+    gcache.stats.nMiss = 0;
+    gcache.stats.nEvict = 0;
+    gcache.stats.mxBytes = gcache.stats.nBytes;
+  }
+  sqlite3_mutex_leave(gcMutex());
+}
@@ -0,0 +1,46 @@
+#ifndef __RSQLITE_PCACHE_H
+#define __RSQLITE_PCACHE_H
+
+// Requires sqlite3.h, included through sqlite3-cpp.h in C++ code
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A page cache for SQLite with one memory budget for all connections.
+ * The unpinned pages of all caches of file databases are evicted in one
+ * least recently used order when the budget is exceeded, so that busy
+ * connections keep more pages than idle ones.  The cache_size of the
+ * connections is ignored.  Caches of in-memory databases are not limited.
+ */
+
+/* Installs the cache with sqlite3_config(SQLITE_CONFIG_PCACHE2), must be
+ * called before SQLite is initialized
+ */
+int RSQLite_install_global_pcache(sqlite3_int64 nBudget);
+
+/* Is the cache installed? */
+int RSQLite_global_pcache_installed(void);
+
+typedef struct RSQLite_pcache_stats RSQLite_pcache_stats;
+struct RSQLite_pcache_stats {
+  sqlite3_int64 nBudget;       /* Bytes */
+  sqlite3_int64 nBytes;        /* Bytes of pages of file databases */
+  sqlite3_int64 mxBytes;       /* High-water mark of nBytes */
+  sqlite3_int64 nPage;         /* Pages of file databases */
+  sqlite3_int64 nCache;        /* Open caches */
+  sqlite3_int64 nHit;
+  sqlite3_int64 nMiss;
+  sqlite3_int64 nEvict;        /* Pages evicted for the budget */
+};
+
+/* Copies the counters, optionally resets hits, misses, evictions and the
+ * high-water mark
+ */
+void RSQLite_global_pcache_stats(RSQLite_pcache_stats* pStats, int bReset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RSQLITE_PCACHE_H
@@ -0,0 +1,47 @@
+#include "pch.h"
+#include "DbConnectionPool.h"
+
+// [[Rcpp::export]]
+SEXP pool_checkout(const std::string& key) {
+  DbConnectionPtr conn = DbConnectionPool::instance().checkout(key);
+  if (!conn) return R_NilValue;
+  return XPtr<DbConnectionPtr>(new DbConnectionPtr(conn), true);
+}
+
+// [[Rcpp::export]]
+void pool_adopt(const XPtr<DbConnectionPtr>& con, const std::string& key) {
+  DbConnectionPool::instance().adopt(*con, key);
+}
+
+// Returns false for connections that are not pooled, or still used by
+// results; the connection handle is invalid afterwards otherwise
+// [[Rcpp::export]]
+bool pool_checkin(XPtr<DbConnectionPtr> con) {
+  if (!con.get() || !con->get()->is_valid() || con->get()->pool_key().empty()) return false;
+  if (con->use_count() > 1) return false;
+
+  DbConnectionPtr conn = *con;
+  con.release();
+  DbConnectionPool::instance().checkin(conn);
+  return true;
+}
+
+// [[Rcpp::export]]
+void pool_configure(const int max_idle, const int statement_cache, const bool readers) {
+  DbConnectionPool::instance().configure(max_idle, statement_cache, readers);
+}
+
+// [[Rcpp::export]]
+List pool_config() {
+  return DbConnectionPool::instance().get_config();
+}
+
+// [[Rcpp::export]]
+List pool_stats(const bool reset) {
+  return DbConnectionPool::instance().get_stats(reset);
+}
+
+// [[Rcpp::export]]
+void pool_clear() {
+  DbConnectionPool::instance().clear();
+}
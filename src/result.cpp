@@ -27,6 +27,11 @@ List result_fetch(DbResult* res, const int n) {
   return res->fetch(n);
 }
 
+// [[Rcpp::export]]
+int result_fetch_chunks(DbResult* res, const int n, SEXP callback) {
+  return res->fetch_chunks(n, callback);
+}
+
 // [[Rcpp::export]]
 void result_bind(DbResult* res, List params) {
   res->bind(params);
@@ -57,6 +62,17 @@ CharacterVector result_get_placeholder_names(SqliteResult* res) {
   return res->get_placeholder_names();
 }
 
+// [[Rcpp::export]]
+void result_set_group_column(SqliteResult* res, const std::string& name) {
+  res->set_group_column(name);
+}
+
+// [[Rcpp::export]]
+void result_set_col_types(SqliteResult* res, std::vector<std::string> names,
+                          std::vector<std::string> types) {
+  res->set_col_types(names, types);
+}
+
 namespace Rcpp {
 
 template<>
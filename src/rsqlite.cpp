@@ -1,5 +1,7 @@
 #include "pch.h"
 #include "sqlite3-cpp.h"
+#include "mem-pool.h"
+#include "pcache.h"
 
 //' RSQLite version
 //'
@@ -21,3 +23,87 @@ CharacterVector rsqliteVersion() {
 void init_logging(const std::string& log_level) {
   plog::init_r(log_level);
 }
+
+// [[Rcpp::export]]
+void init_memory(bool pool, int lookaside_size, int lookaside_count, double page_cache) {
+  if (pool) {
+    int rc = RSQLite_install_mem_pool();
+    if (rc != SQLITE_OK) {
+      stop("Could not install the memory pool: %s", sqlite3_errstr(rc));
+    }
+  }
+  if (page_cache > 0) {
+    int rc = RSQLite_install_global_pcache(static_cast<sqlite3_int64>(page_cache));
+    if (rc != SQLITE_OK) {
+      stop("Could not install the page cache: %s", sqlite3_errstr(rc));
+    }
+  }
+  if (lookaside_size > 0) {
+    int rc = sqlite3_config(SQLITE_CONFIG_LOOKASIDE, lookaside_size, lookaside_count);
+    if (rc != SQLITE_OK) {
+      stop("Could not configure lookaside memory: %s", sqlite3_errstr(rc));
+    }
+  }
+}
+
+// [[Rcpp::export]]
+List memory_stats(bool reset) {
+  sqlite3_int64 used = 0, highwater = 0;
+  sqlite3_status64(SQLITE_STATUS_MEMORY_USED, &used, &highwater, reset);
+
+  List ret = List::create(
+    _["used"] = static_cast<double>(used),
+    _["highwater"] = static_cast<double>(highwater),
+    _["soft_heap_limit"] = static_cast<double>(sqlite3_soft_heap_limit64(-1)),
+    _["pool"] = R_NilValue,
+    _["page_cache"] = R_NilValue
+  );
+
+  if (RSQLite_global_pcache_installed()) {
+    RSQLite_pcache_stats pcache;
+    RSQLite_global_pcache_stats(&pcache, reset);
+    ret["page_cache"] = List::create(
+      _["budget"] = static_cast<double>(pcache.nBudget),
+      _["bytes"] = static_cast<double>(pcache.nBytes),
+      _["bytes_highwater"] = static_cast<double>(pcache.mxBytes),
+      _["pages"] = static_cast<double>(pcache.nPage),
+      _["caches"] = static_cast<double>(pcache.nCache),
+      _["hits"] = static_cast<double>(pcache.nHit),
+      _["misses"] = static_cast<double>(pcache.nMiss),
+      _["evictions"] = static_cast<double>(pcache.nEvict)
+    );
+  }
+
+  if (!RSQLite_mem_pool_installed())
+    return ret;
+
+  RSQLite_pool_stats stats;
+  RSQLite_mem_pool_stats(&stats, reset);
+
+  // Size classes, then the system allocator
+  const int n = RSQLITE_POOL_NCLASS + 1;
+  NumericVector size(n), allocs(n), in_use(n), in_use_highwater(n), bytes(n),
+    bytes_highwater(n), reserved(n);
+  for (int i = 0; i < n; ++i) {
+    const RSQLite_pool_counts& c = stats.aClass[i];
+    size[i] = (i < RSQLITE_POOL_NCLASS) ? (RSQLITE_POOL_MIN_SIZE << i) : NA_REAL;
+    allocs[i] = static_cast<double>(c.nAlloc);
+    in_use[i] = static_cast<double>(c.nInUse);
+    in_use_highwater[i] = static_cast<double>(c.mxInUse);
+    bytes[i] = static_cast<double>(c.nBytesInUse);
+    bytes_highwater[i] = static_cast<double>(c.mxBytesInUse);
+    reserved[i] = static_cast<double>(c.nReserved);
+  }
+
+  ret["pool"] = List::create(
+    _["size"] = size, _["allocs"] = allocs, _["in_use"] = in_use,
+    _["in_use_highwater"] = in_use_highwater, _["bytes"] = bytes,
+    _["bytes_highwater"] = bytes_highwater, _["reserved"] = reserved
+  );
+  return ret;
+}
+
+// [[Rcpp::export]]
+double memory_soft_heap_limit(double n) {
+  return static_cast<double>(sqlite3_soft_heap_limit64(static_cast<sqlite3_int64>(n)));
+}
@@ -0,0 +1,933 @@
+/*
+ * A VFS shim that stores the pages of main database files compressed.
+ *
+ * Journals, WAL files and temporary files are passed through unchanged.
+ * Each database page is compressed with the LZ4 block format and stored in
+ * a slot of the underlying file; a page map translates page numbers to slot
+ * offsets.  The layout of the underlying file is:
+ *
+ *   [0, 512)      header copy 0
+ *   [512, 1024)   header copy 1
+ *   [1024, ...)   page slots and two page map slots, in allocation order
+ *
+ * A header copy holds the generation, the page size and count, the location
+ * of its page map and the end of the allocated area.  Generation g is always
+ * written to header copy g % 2 together with map slot g % 2, so the previous
+ * generation stays intact until the new one is complete.  The newest header
+ * copy with valid checksums wins when the file is read.
+ *
+ * Each page slot starts with the size of the compressed page, followed by
+ * the compressed data (or the raw page if it does not compress).  A page
+ * that is rewritten stays in its slot if it fits, otherwise it is moved to
+ * the end of the file and the old slot becomes garbage.  Crash recovery
+ * relies on the rollback journal: all slots referenced by an older map are
+ * still self-describing.  `VACUUM INTO` writes a compacted copy.
+ *
+ * The page map is written when the pager syncs the database before it
+ * finalizes the journal (SQLITE_FCNTL_SYNC, sent also with
+ * `PRAGMA synchronous = OFF`, when xSync is not called), after a checkpoint,
+ * and when the database is unlocked.  Shared memory and
+ * memory-mapped I/O are not supported, WAL mode therefore requires
+ * `PRAGMA locking_mode = EXCLUSIVE`.  The page size cannot be changed once
+ * the first page has been written.
+ *
+ * `PRAGMA compress_stats` returns the page counts, compressed size, and
+ * page cache statistics of the main database.
+ */
+
+#include <string.h>
+#include "vendor/sqlite3/sqlite3.h"
+#include "vfs.h"
+
+typedef unsigned char u8;
+typedef unsigned int u32;
+typedef sqlite3_uint64 u64;
+typedef sqlite3_int64 i64;
+
+#define ZHDR_SIZE      512        /* Size of one header copy */
+#define ZDATA_START    1024       /* First byte after both header copies */
+#define ZMAP_ENTRY     12         /* Bytes per page map entry */
+#define ZCACHE_SIZE    64         /* Decompressed pages cached per file */
+
+static const char zMagic[16] = "RSQLite zpage 1";
+
+
+/* LZ4 block format ***********************************************************/
+
+/* A small compressor and decompressor for the LZ4 block format
+ * (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md).
+ * The compressor is greedy with a single hash table; its output can be read
+ * by any LZ4 implementation.
+ */
+
+#define LZ4_MINMATCH       4
+#define LZ4_LASTLITERALS   5
+#define LZ4_MFLIMIT        12
+#define LZ4_HASH_LOG       12
+#define LZ4_MAX_DISTANCE   65535
+
+static int lz4Bound(int n) {
+  return n + n / 255 + 16;
+}
+
+static u32 lz4Read32(const u8* p) {
+  u32 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static u32 lz4Hash(u32 v) {
+  return (v * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+static u8* lz4PutLength(u8* op, int n) {
+  for (; n >= 255; n -= 255) *op++ = 255;
+  *op++ = (u8)n;
+  return op;
+}
+
+/* Returns the compressed size, or 0 if the output does not fit into nDst */
+static int lz4Compress(const u8* src, int nSrc, u8* dst, int nDst) {
+  int aHash[1 << LZ4_HASH_LOG];
+  int ip = 0, anchor = 0;
+  const int mflimit = nSrc - LZ4_MFLIMIT;
+  const int matchlimit = nSrc - LZ4_LASTLITERALS;
+  u8* op = dst;
+  u8* const oend = dst + nDst;
+  int nLit;
+
+  memset(aHash, 0, sizeof(aHash));
+
+  while (ip < mflimit) {
+    u32 v = lz4Read32(src + ip);
+    u32 h = lz4Hash(v);
+    int ref = aHash[h] - 1;
+    int nMatch;
+    u8* token;
+    aHash[h] = ip + 1;
+
+    if (ref < 0 || ip - ref > LZ4_MAX_DISTANCE || lz4Read32(src + ref) != v) {
+      /* Skip faster through data that does not compress */
+      ip += 1 + ((ip - anchor) >> 6);
+      continue;
+    }
+
+    nMatch = LZ4_MINMATCH;
+    while (ip + nMatch < matchlimit && src[ref + nMatch] == src[ip + nMatch]) {
+      nMatch++;
+    }
+
+    nLit = ip - anchor;
+    if (op + 1 + nLit + nLit / 255 + 1 + 2 + (nMatch - LZ4_MINMATCH) / 255 + 1 > oend) {
+      return 0;
+    }
+    token = op++;
+    *token = (u8)((nLit >= 15 ? 15 : nLit) << 4);
+    if (nLit >= 15) op = lz4PutLength(op, nLit - 15);
+    memcpy(op, src + anchor, nLit);
+    op += nLit;
+
+    *op++ = (u8)((ip - ref) & 0xff);
+    *op++ = (u8)((ip - ref) >> 8);
+    if (nMatch - LZ4_MINMATCH >= 15) {
+      *token |= 15;
+      op = lz4PutLength(op, nMatch - LZ4_MINMATCH - 15);
+    } else {
+      *token |= (u8)(nMatch - LZ4_MINMATCH);
+    }
+
+    ip += nMatch;
+    anchor = ip;
+  }
+
+  /* The last sequence only consists of literals */
+  nLit = nSrc - anchor;
+  if (op + 1 + nLit + nLit / 255 + 1 > oend) {
+    return 0;
+  }
+  *op++ = (u8)((nLit >= 15 ? 15 : nLit) << 4);
+  if (nLit >= 15) op = lz4PutLength(op, nLit - 15);
+  memcpy(op, src + anchor, nLit);
+  op += nLit;
+
+  return (int)(op - dst);
+}
+
+/* Returns the decompressed size, or -1 if the input is malformed or the
+ * output does not fit into nDst */
+static int lz4Decompress(const u8* src, int nSrc, u8* dst, int nDst) {
+  const u8* ip = src;
+  const u8* const iend = src + nSrc;
+  u8* op = dst;
+  u8* const oend = dst + nDst;
+
+  while (ip < iend) {
+    u32 token = *ip++;
+    size_t nLit = token >> 4;
+    size_t nMatch, off;
+    const u8* match;
+
+    if (nLit == 15) {
+      u32 b;
+      do {
+        if (ip >= iend) return -1;
+        b = *ip++;
+        nLit += b;
+      } while (b == 255);
+    }
+    if (nLit > (size_t)(iend - ip) || nLit > (size_t)(oend - op)) return -1;
+    memcpy(op, ip, nLit);
+    op += nLit;
+    ip += nLit;
+
+    if (ip >= iend) break;
+
+    if (iend - ip < 2) return -1;
+    off = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    if (off == 0 || off > (size_t)(op - dst)) return -1;
+
+    nMatch = token & 15;
+    if (nMatch == 15) {
+      u32 b;
+      do {
+        if (ip >= iend) return -1;
+        b = *ip++;
+        nMatch += b;
+      } while (b == 255);
+    }
+    nMatch += LZ4_MINMATCH;
+    if (nMatch > (size_t)(oend - op)) return -1;
+
+    /* Byte-wise copy, source and destination may overlap */
+    match = op - off;
+    while (nMatch--) *op++ = *match++;
+  }
+
+  return (int)(op - dst);
+}
+
+
+/* Helpers ********************************************************************/
+
+static u32 zGet32(const u8* p) {
+  return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | (u32)p[3];
+}
+
+static void zPut32(u8* p, u32 v) {
+  p[0] = (u8)(v >> 24);
+  p[1] = (u8)(v >> 16);
+  p[2] = (u8)(v >> 8);
+  p[3] = (u8)v;
+}
+
+static u64 zGet64(const u8* p) {
+  return ((u64)zGet32(p) << 32) | zGet32(p + 4);
+}
+
+static void zPut64(u8* p, u64 v) {
+  zPut32(p, (u32)(v >> 32));
+  zPut32(p + 4, (u32)v);
+}
+
+/* FNV-1a */
+static u32 zChecksum(const u8* p, size_t n) {
+  u32 h = 2166136261U;
+  size_t i;
+  for (i = 0; i < n; i++) {
+    h = (h ^ p[i]) * 16777619U;
+  }
+  return h;
+}
+
+
+/* File *********************************************************************/
+
+typedef struct ZSlot ZSlot;
+struct ZSlot {
+  u64 iOff;                 /* Offset in the underlying file, 0 if unset */
+  u32 nCap;                 /* Bytes reserved for the slot */
+};
+
+typedef struct ZCacheEntry ZCacheEntry;
+struct ZCacheEntry {
+  u32 iPg;                  /* Page number + 1, 0 if unused */
+  u8* aData;                /* Decompressed page */
+};
+
+typedef struct ZFile ZFile;
+struct ZFile {
+  sqlite3_file base;
+  sqlite3_file* pReal;      /* Underlying file, allocated after this struct */
+  int isDb;                 /* Compressed main database file? */
+  int isLoaded;             /* Header and page map read? */
+  int isDirty;              /* Page map changed since it was last written? */
+  int eLock;
+
+  u32 iGen;                 /* Generation of the current header */
+  u32 szPage;               /* Page size, 0 until the first write */
+  u32 nPage;                /* Number of pages */
+  ZSlot* aSlot;             /* Page map, nSlotAlloc entries */
+  u32 nSlotAlloc;
+  u64 iEnd;                 /* End of the allocated area */
+  u64 aMapOff[2];           /* Location of the map slots */
+  u32 aMapCap[2];           /* Capacity of the map slots, in entries */
+
+  ZCacheEntry aCache[ZCACHE_SIZE];
+  u8* aBuf;                 /* Buffer for a compressed page */
+  int nBuf;
+  u8* aPage;                /* Buffer for partial page writes */
+
+  i64 nRead;                /* Page reads served */
+  i64 nCacheHit;            /* ... from the cache */
+  i64 nWrite;               /* Pages written */
+  i64 nRelocate;            /* ... that had to be moved */
+  i64 nBytesIn;             /* Uncompressed bytes written */
+  i64 nBytesOut;            /* Compressed bytes written */
+};
+
+static void zCacheClear(ZFile* p) {
+  int i;
+  for (i = 0; i < ZCACHE_SIZE; i++) {
+    sqlite3_free(p->aCache[i].aData);
+    p->aCache[i].aData = NULL;
+    p->aCache[i].iPg = 0;
+  }
+}
+
+static void zReset(ZFile* p) {
+  zCacheClear(p);
+  sqlite3_free(p->aSlot);
+  sqlite3_free(p->aBuf);
+  sqlite3_free(p->aPage);
+  p->aSlot = NULL;
+  p->aBuf = NULL;
+  p->aPage = NULL;
+  p->nSlotAlloc = 0;
+  p->nBuf = 0;
+  p->iGen = 0;
+  p->szPage = 0;
+  p->nPage = 0;
+  p->iEnd = ZDATA_START;
+  p->aMapOff[0] = p->aMapOff[1] = 0;
+  p->aMapCap[0] = p->aMapCap[1] = 0;
+}
+
+static int zSetPageSize(ZFile* p, u32 szPage) {
+  if (szPage < 512 || szPage > 65536 || (szPage & (szPage - 1)) != 0) {
+    return SQLITE_CORRUPT;
+  }
+  p->szPage = szPage;
+  p->nBuf = 4 + lz4Bound((int)szPage);
+  p->aBuf = sqlite3_malloc(p->nBuf);
+  if (p->aBuf == NULL) return SQLITE_NOMEM;
+  return SQLITE_OK;
+}
+
+static int zResizeMap(ZFile* p, u32 nPage) {
+  if (nPage > p->nSlotAlloc) {
+    u32 nNew = nPage + nPage / 2 + 16;
+    ZSlot* aNew = sqlite3_realloc64(p->aSlot, (u64)nNew * sizeof(ZSlot));
+    if (aNew == NULL) return SQLITE_NOMEM;
+    memset(aNew + p->nSlotAlloc, 0, (nNew - p->nSlotAlloc) * sizeof(ZSlot));
+    p->aSlot = aNew;
+    p->nSlotAlloc = nNew;
+  }
+  return SQLITE_OK;
+}
+
+/* Parses a header copy, returns 0 if it is not valid */
+static int zParseHeader(const u8* a, u32* piGen, u32* pszPage, u32* pnPage,
+                        u64* piMapOff, u32* pnMapCap, u64* piEnd, u32* pMapSum) {
+  if (memcmp(a, zMagic, sizeof(zMagic)) != 0) return 0;
+  if (zGet32(a + 52) != zChecksum(a, 52)) return 0;
+  *piGen = zGet32(a + 16);
+  *pszPage = zGet32(a + 20);
+  *pnPage = zGet32(a + 24);
+  *piMapOff = zGet64(a + 28);
+  *pnMapCap = zGet32(a + 36);
+  *piEnd = zGet64(a + 40);
+  *pMapSum = zGet32(a + 48);
+  return *pnMapCap >= *pnPage;
+}
+
+/* Reads the page map stored for a header copy */
+static int zReadMap(ZFile* p, u64 iMapOff, u32 nPage, u32 nMapSum) {
+  u8* a;
+  u32 i;
+  int rc;
+
+  rc = zResizeMap(p, nPage);
+  if (rc != SQLITE_OK) return rc;
+  if (nPage == 0) return SQLITE_OK;
+
+  a = sqlite3_malloc64((u64)nPage * ZMAP_ENTRY);
+  if (a == NULL) return SQLITE_NOMEM;
+  rc = p->pReal->pMethods->xRead(p->pReal, a, (int)(nPage * ZMAP_ENTRY), (i64)iMapOff);
+  if (rc == SQLITE_OK && zChecksum(a, (size_t)nPage * ZMAP_ENTRY) != nMapSum) {
+    rc = SQLITE_CORRUPT;
+  }
+  if (rc == SQLITE_OK) {
+    for (i = 0; i < nPage; i++) {
+      p->aSlot[i].iOff = zGet64(a + i * ZMAP_ENTRY);
+      p->aSlot[i].nCap = zGet32(a + i * ZMAP_ENTRY + 8);
+    }
+  } else if (rc == SQLITE_IOERR_SHORT_READ) {
+    rc = SQLITE_CORRUPT;
+  }
+  sqlite3_free(a);
+  return rc;
+}
+
+/* Reads the newest valid header and its page map, if the generation has
+ * changed since the last call */
+static int zLoad(ZFile* p) {
+  u8 aHdr[ZDATA_START];
+  i64 nSize;
+  int rc, i, iBest = -1;
+  u32 aGen[2], aSzPage[2], aNPage[2], aMapCap[2], aMapSum[2];
+  u64 aMapOff[2], aEnd[2];
+  int aValid[2];
+
+  rc = p->pReal->pMethods->xFileSize(p->pReal, &nSize);
+  if (rc != SQLITE_OK) return rc;
+
+  if (nSize == 0) {
+    zReset(p);
+    p->isLoaded = 1;
+    p->isDirty = 0;
+    return SQLITE_OK;
+  }
+  if (nSize < ZDATA_START) return SQLITE_NOTADB;
+
+  rc = p->pReal->pMethods->xRead(p->pReal, aHdr, ZDATA_START, 0);
+  if (rc != SQLITE_OK) return rc;
+
+  for (i = 0; i < 2; i++) {
+    aValid[i] = zParseHeader(aHdr + i * ZHDR_SIZE, &aGen[i], &aSzPage[i], &aNPage[i],
+                             &aMapOff[i], &aMapCap[i], &aEnd[i], &aMapSum[i]);
+  }
+
+  /* Newest generation first, fall back to the other copy if its map is bad */
+  for (i = 0; i < 2; i++) {
+    int iTry;
+    if (i == 0) {
+      iTry = (aValid[0] && (!aValid[1] || aGen[0] > aGen[1])) ? 0 : 1;
+    } else {
+      iTry = 1 - iBest;
+    }
+    iBest = iTry;
+    if (!aValid[iTry]) continue;
+
+    if (p->isLoaded && aGen[iTry] == p->iGen && aSzPage[iTry] == p->szPage) {
+      return SQLITE_OK;
+    }
+
+    zReset(p);
+    p->isLoaded = 0;
+    if (aSzPage[iTry] != 0) {
+      rc = zSetPageSize(p, aSzPage[iTry]);
+      if (rc != SQLITE_OK) return rc;
+    }
+    rc = zReadMap(p, aMapOff[iTry], aNPage[iTry], aMapSum[iTry]);
+    if (rc == SQLITE_CORRUPT) continue;
+    if (rc != SQLITE_OK) return rc;
+
+    p->iGen = aGen[iTry];
+    p->nPage = aNPage[iTry];
+    p->iEnd = aEnd[iTry];
+    p->aMapOff[iTry] = aMapOff[iTry];
+    p->aMapCap[iTry] = aMapCap[iTry];
+    /* The map slot of the other copy can be reused if it is known */
+    if (aValid[1 - iTry] && aGen[1 - iTry] < aGen[iTry]) {
+      p->aMapOff[1 - iTry] = aMapOff[1 - iTry];
+      p->aMapCap[1 - iTry] = aMapCap[1 - iTry];
+    }
+    p->isLoaded = 1;
+    p->isDirty = 0;
+    return SQLITE_OK;
+  }
+
+  return SQLITE_NOTADB;
+}
+
+/* Writes the page map and a new header, syncing in between if requested */
+static int zFlush(ZFile* p, int syncFlags) {
+  sqlite3_file* pReal = p->pReal;
+  u32 iGen = p->iGen + 1;
+  int k = (int)(iGen % 2);
+  u8 aHdr[ZHDR_SIZE];
+  u8* a = NULL;
+  u32 i, nMapSum;
+  int rc;
+
+  if (p->aMapCap[k] < p->nPage) {
+    p->aMapCap[k] = p->nPage + p->nPage / 4 + 64;
+    p->aMapOff[k] = p->iEnd;
+    p->iEnd += (u64)p->aMapCap[k] * ZMAP_ENTRY;
+  }
+
+  if (p->nPage > 0) {
+    a = sqlite3_malloc64((u64)p->nPage * ZMAP_ENTRY);
+    if (a == NULL) return SQLITE_NOMEM;
+    for (i = 0; i < p->nPage; i++) {
+      zPut64(a + i * ZMAP_ENTRY, p->aSlot[i].iOff);
+      zPut32(a + i * ZMAP_ENTRY + 8, p->aSlot[i].nCap);
+    }
+    nMapSum = zChecksum(a, (size_t)p->nPage * ZMAP_ENTRY);
+    rc = pReal->pMethods->xWrite(pReal, a, (int)(p->nPage * ZMAP_ENTRY), (i64)p->aMapOff[k]);
+    sqlite3_free(a);
+    if (rc != SQLITE_OK) return rc;
+  } else {
+    nMapSum = zChecksum(NULL, 0);
+  }
+
+  if (syncFlags) {
+    rc = pReal->pMethods->xSync(pReal, syncFlags);
+    if (rc != SQLITE_OK) return rc;
+  }
+
+  memset(aHdr, 0, sizeof(aHdr));
+  memcpy(aHdr, zMagic, sizeof(zMagic));
+  zPut32(aHdr + 16, iGen);
+  zPut32(aHdr + 20, p->szPage);
+  zPut32(aHdr + 24, p->nPage);
+  zPut64(aHdr + 28, p->aMapOff[k]);
+  zPut32(aHdr + 36, p->aMapCap[k]);
+  zPut64(aHdr + 40, p->iEnd);
+  zPut32(aHdr + 48, nMapSum);
+  zPut32(aHdr + 52, zChecksum(aHdr, 52));
+  rc = pReal->pMethods->xWrite(pReal, aHdr, ZHDR_SIZE, (i64)k * ZHDR_SIZE);
+  if (rc != SQLITE_OK) return rc;
+
+  if (syncFlags) {
+    rc = pReal->pMethods->xSync(pReal, syncFlags);
+    if (rc != SQLITE_OK) return rc;
+  }
+
+  p->iGen = iGen;
+  p->isDirty = 0;
+  return SQLITE_OK;
+}
+
+/* Returns the decompressed page, from the cache if possible */
+static int zReadPage(ZFile* p, u32 iPg, const u8** ppData) {
+  ZCacheEntry* pEntry = &p->aCache[iPg % ZCACHE_SIZE];
+  ZSlot* pSlot;
+  int rc;
+
+  p->nRead++;
+  if (pEntry->iPg == iPg + 1) {
+    p->nCacheHit++;
+    *ppData = pEntry->aData;
+    return SQLITE_OK;
+  }
+
+  if (pEntry->aData == NULL) {
+    pEntry->aData = sqlite3_malloc((int)p->szPage);
+    if (pEntry->aData == NULL) return SQLITE_NOMEM;
+  }
+  pEntry->iPg = 0;
+
+  pSlot = &p->aSlot[iPg];
+  if (pSlot->iOff == 0) {
+    memset(pEntry->aData, 0, p->szPage);
+  } else {
+    u32 nCompressed;
+    if (pSlot->nCap < 4 || pSlot->nCap > (u32)p->nBuf) return SQLITE_CORRUPT;
+    rc = p->pReal->pMethods->xRead(p->pReal, p->aBuf, (int)pSlot->nCap, (i64)pSlot->iOff);
+    /* The last slot in the file may be shorter than its capacity */
+    if (rc != SQLITE_OK && rc != SQLITE_IOERR_SHORT_READ) return rc;
+
+    nCompressed = zGet32(p->aBuf);
+    if (nCompressed > pSlot->nCap - 4) return SQLITE_CORRUPT;
+    if (nCompressed == p->szPage) {
+      memcpy(pEntry->aData, p->aBuf + 4, p->szPage);
+    } else if (lz4Decompress(p->aBuf + 4, (int)nCompressed, pEntry->aData, (int)p->szPage) != (int)p->szPage) {
+      return SQLITE_CORRUPT;
+    }
+  }
+
+  pEntry->iPg = iPg + 1;
+  *ppData = pEntry->aData;
+  return SQLITE_OK;
+}
+
+/* Compresses and stores a full page */
+static int zWritePage(ZFile* p, u32 iPg, const u8* aData) {
+  ZCacheEntry* pEntry = &p->aCache[iPg % ZCACHE_SIZE];
+  ZSlot* pSlot;
+  int nCompressed, rc;
+  u32 nNeed;
+
+  nCompressed = lz4Compress(aData, (int)p->szPage, p->aBuf + 4, p->nBuf - 4);
+  if (nCompressed == 0 || nCompressed >= (int)p->szPage) {
+    memcpy(p->aBuf + 4, aData, p->szPage);
+    nCompressed = (int)p->szPage;
+  }
+  zPut32(p->aBuf, (u32)nCompressed);
+  nNeed = 4 + (u32)nCompressed;
+
+  if (iPg >= p->nPage) {
+    rc = zResizeMap(p, iPg + 1);
+    if (rc != SQLITE_OK) return rc;
+    p->nPage = iPg + 1;
+  }
+
+  pSlot = &p->aSlot[iPg];
+  if (pSlot->nCap < nNeed) {
+    /* Leave some room so that the page can grow in place */
+    u32 nCap = (nNeed + nNeed / 8 + 15) & ~15U;
+    if (nCap > 4 + p->szPage) nCap = 4 + p->szPage;
+    if (pSlot->iOff != 0) p->nRelocate++;
+    pSlot->iOff = p->iEnd;
+    pSlot->nCap = nCap;
+    p->iEnd += nCap;
+  }
+
+  rc = p->pReal->pMethods->xWrite(p->pReal, p->aBuf, (int)nNeed, (i64)pSlot->iOff);
+  if (rc != SQLITE_OK) return rc;
+  p->isDirty = 1;
+
+  p->nWrite++;
+  p->nBytesIn += p->szPage;
+  p->nBytesOut += nNeed;
+
+  if (pEntry->aData == NULL) {
+    pEntry->aData = sqlite3_malloc((int)p->szPage);
+  }
+  if (pEntry->aData != NULL) {
+    memcpy(pEntry->aData, aData, p->szPage);
+    pEntry->iPg = iPg + 1;
+  }
+  return SQLITE_OK;
+}
+
+static int zEnsureLoaded(ZFile* p) {
+  return p->isLoaded ? SQLITE_OK : zLoad(p);
+}
+
+static int zClose(sqlite3_file* pFile) {
+  ZFile* p = (ZFile*)pFile;
+  int rc = SQLITE_OK;
+  if (p->isDb && p->isDirty) {
+    rc = zFlush(p, 0);
+  }
+  zReset(p);
+  if (p->pReal->pMethods) {
+    int rc2 = p->pReal->pMethods->xClose(p->pReal);
+    if (rc == SQLITE_OK) rc = rc2;
+  }
+  return rc;
+}
+
+static int zRead(sqlite3_file* pFile, void* zBuf, int iAmt, sqlite3_int64 iOfst) {
+  ZFile* p = (ZFile*)pFile;
+  u8* pOut = (u8*)zBuf;
+  int rc;
+
+  if (!p->isDb) {
+    return p->pReal->pMethods->xRead(p->pReal, zBuf, iAmt, iOfst);
+  }
+
+  rc = zEnsureLoaded(p);
+  if (rc != SQLITE_OK) return rc;
+
+  while (iAmt > 0) {
+    const u8* aData;
+    u32 iPg, iOff;
+    int n;
+
+    if (p->szPage == 0 || (u64)iOfst >= (u64)p->nPage * p->szPage) {
+      memset(pOut, 0, iAmt);
+      return SQLITE_IOERR_SHORT_READ;
+    }
+
+    iPg = (u32)(iOfst / p->szPage);
+    iOff = (u32)(iOfst % p->szPage);
+    n = (int)(p->szPage - iOff);
+    if (n > iAmt) n = iAmt;
+
+    rc = zReadPage(p, iPg, &aData);
+    if (rc != SQLITE_OK) return rc;
+    memcpy(pOut, aData + iOff, n);
+
+    pOut += n;
+    iOfst += n;
+    iAmt -= n;
+  }
+
+  return SQLITE_OK;
+}
+
+static int zWrite(sqlite3_file* pFile, const void* zBuf, int iAmt, sqlite3_int64 iOfst) {
+  ZFile* p = (ZFile*)pFile;
+  const u8* pIn = (const u8*)zBuf;
+  int rc;
+
+  if (!p->isDb) {
+    return p->pReal->pMethods->xWrite(p->pReal, zBuf, iAmt, iOfst);
+  }
+
+  rc = zEnsureLoaded(p);
+  if (rc != SQLITE_OK) return rc;
+
+  if (p->szPage == 0) {
+    /* The first write is a full page, it determines the page size */
+    if (iAmt <= 0 || iOfst % iAmt != 0 || zSetPageSize(p, (u32)iAmt) != SQLITE_OK) {
+      return SQLITE_IOERR_WRITE;
+    }
+  } else if (iOfst == 0 && iAmt > (int)p->szPage) {
+    /* Changing the page size is not supported */
+    return SQLITE_IOERR_WRITE;
+  }
+
+  while (iAmt > 0) {
+    u32 iPg = (u32)(iOfst / p->szPage);
+    u32 iOff = (u32)(iOfst % p->szPage);
+    int n = (int)(p->szPage - iOff);
+    if (n > iAmt) n = iAmt;
+
+    if (n == (int)p->szPage) {
+      rc = zWritePage(p, iPg, pIn);
+    } else {
+      /* Partial page: read, modify, write */
+      const u8* aOld = NULL;
+      if (p->aPage == NULL) {
+        p->aPage = sqlite3_malloc((int)p->szPage);
+        if (p->aPage == NULL) return SQLITE_NOMEM;
+      }
+      if (iPg < p->nPage) {
+        rc = zReadPage(p, iPg, &aOld);
+        if (rc != SQLITE_OK) return rc;
+        memcpy(p->aPage, aOld, p->szPage);
+      } else {
+        memset(p->aPage, 0, p->szPage);
+      }
+      memcpy(p->aPage + iOff, pIn, n);
+      rc = zWritePage(p, iPg, p->aPage);
+    }
+    if (rc != SQLITE_OK) return rc;
+
+    pIn += n;
+    iOfst += n;
+    iAmt -= n;
+  }
+
+  return SQLITE_OK;
+}
+
+static int zTruncate(sqlite3_file* pFile, sqlite3_int64 size) {
+  ZFile* p = (ZFile*)pFile;
+  u32 nPage, i;
+  int rc;
+
+  if (!p->isDb) {
+    return p->pReal->pMethods->xTruncate(p->pReal, size);
+  }
+
+  rc = zEnsureLoaded(p);
+  if (rc != SQLITE_OK) return rc;
+
+  if (size == 0) {
+    /* Keep counting generations so that other connections notice */
+    u32 iGen = p->iGen;
+    zReset(p);
+    p->iGen = iGen;
+    p->isDirty = 0;
+    return p->pReal->pMethods->xTruncate(p->pReal, 0);
+  }
+  if (p->szPage == 0) return SQLITE_OK;
+
+  nPage = (u32)((size + p->szPage - 1) / p->szPage);
+  if (nPage >= p->nPage) return SQLITE_OK;
+
+  /* Slots of dropped pages become garbage */
+  for (i = nPage; i < p->nPage; i++) {
+    p->aSlot[i].iOff = 0;
+    p->aSlot[i].nCap = 0;
+  }
+  for (i = 0; i < ZCACHE_SIZE; i++) {
+    if (p->aCache[i].iPg > nPage) p->aCache[i].iPg = 0;
+  }
+  p->nPage = nPage;
+  p->isDirty = 1;
+  return SQLITE_OK;
+}
+
+static int zSync(sqlite3_file* pFile, int flags) {
+  ZFile* p = (ZFile*)pFile;
+  if (p->isDb && p->isDirty) {
+    return zFlush(p, flags);
+  }
+  return p->pReal->pMethods->xSync(p->pReal, flags);
+}
+
+static int zFileSize(sqlite3_file* pFile, sqlite3_int64* pSize) {
+  ZFile* p = (ZFile*)pFile;
+  int rc;
+
+  if (!p->isDb) {
+    return p->pReal->pMethods->xFileSize(p->pReal, pSize);
+  }
+
+  rc = zEnsureLoaded(p);
+  if (rc != SQLITE_OK) return rc;
+  *pSize = (i64)p->nPage * p->szPage;
+  return SQLITE_OK;
+}
+
+static int zLock(sqlite3_file* pFile, int eLock) {
+  ZFile* p = (ZFile*)pFile;
+  int rc = p->pReal->pMethods->xLock(p->pReal, eLock);
+
+  if (rc == SQLITE_OK && p->isDb && p->eLock == SQLITE_LOCK_NONE) {
+    /* Another connection may have changed the file since we last read it */
+    rc = zLoad(p);
+    if (rc != SQLITE_OK) {
+      p->pReal->pMethods->xUnlock(p->pReal, SQLITE_LOCK_NONE);
+      return rc;
+    }
+  }
+  if (rc == SQLITE_OK) p->eLock = eLock;
+  return rc;
+}
+
+static int zUnlock(sqlite3_file* pFile, int eLock) {
+  ZFile* p = (ZFile*)pFile;
+  int rc;
+
+  if (p->isDb && p->isDirty && eLock < SQLITE_LOCK_RESERVED) {
+    /* Publish the page map before other connections can read the file */
+    rc = zFlush(p, 0);
+    if (rc != SQLITE_OK) return rc;
+  }
+
+  rc = p->pReal->pMethods->xUnlock(p->pReal, eLock);
+  if (rc == SQLITE_OK) p->eLock = eLock;
+  return rc;
+}
+
+static int zCheckReservedLock(sqlite3_file* pFile, int* pResOut) {
+  ZFile* p = (ZFile*)pFile;
+  return p->pReal->pMethods->xCheckReservedLock(p->pReal, pResOut);
+}
+
+static int zFileControl(sqlite3_file* pFile, int op, void* pArg) {
+  ZFile* p = (ZFile*)pFile;
+  int rc;
+
+  if (p->isDb) {
+    switch (op) {
+    case SQLITE_FCNTL_SIZE_HINT:
+    case SQLITE_FCNTL_CHUNK_SIZE:
+      /* Refer to uncompressed sizes, meaningless for the underlying file */
+      return SQLITE_OK;
+
+    case SQLITE_FCNTL_SYNC:
+    case SQLITE_FCNTL_CKPT_DONE:
+      /* The transaction is committed once the journal is deleted or the WAL
+       * is reset, which may follow without xSync: publish the map first */
+      if (p->isDirty) {
+        rc = zFlush(p, 0);
+        if (rc != SQLITE_OK) return rc;
+      }
+      break;
+
+    case SQLITE_FCNTL_PRAGMA: {
+      char** azArg = (char**)pArg;
+      if (sqlite3_stricmp(azArg[1], "compress_stats") == 0) {
+        i64 nPhysical = 0;
+        rc = zEnsureLoaded(p);
+        if (rc == SQLITE_OK) {
+          rc = p->pReal->pMethods->xFileSize(p->pReal, &nPhysical);
+        }
+        if (rc != SQLITE_OK) return rc;
+        azArg[0] = sqlite3_mprintf(
+          "page_size=%u pages=%u logical_bytes=%lld physical_bytes=%lld "
+          "page_reads=%lld cache_hits=%lld page_writes=%lld relocations=%lld "
+          "bytes_in=%lld bytes_out=%lld",
+          p->szPage, p->nPage, (i64)p->nPage * p->szPage, nPhysical,
+          p->nRead, p->nCacheHit, p->nWrite, p->nRelocate,
+          p->nBytesIn, p->nBytesOut
+        );
+        return SQLITE_OK;
+      }
+      break;
+    }
+    }
+  }
+
+  rc = p->pReal->pMethods->xFileControl(p->pReal, op, pArg);
+  if (rc == SQLITE_OK && op == SQLITE_FCNTL_VFSNAME) {
+    *(char**)pArg = sqlite3_mprintf("compress/%z", *(char**)pArg);
+  }
+  return rc;
+}
+
+static int zSectorSize(sqlite3_file* pFile) {
+  ZFile* p = (ZFile*)pFile;
+  return p->pReal->pMethods->xSectorSize(p->pReal);
+}
+
+static int zDeviceCharacteristics(sqlite3_file* pFile) {
+  ZFile* p = (ZFile*)pFile;
+  int flags = p->pReal->pMethods->xDeviceCharacteristics(p->pReal);
+  if (p->isDb) {
+    /* Page writes are neither atomic nor aligned with the sectors */
+    flags &= ~(SQLITE_IOCAP_ATOMIC | SQLITE_IOCAP_ATOMIC512 |
+               SQLITE_IOCAP_ATOMIC1K | SQLITE_IOCAP_ATOMIC2K |
+               SQLITE_IOCAP_ATOMIC4K | SQLITE_IOCAP_ATOMIC8K |
+               SQLITE_IOCAP_ATOMIC16K | SQLITE_IOCAP_ATOMIC32K |
+               SQLITE_IOCAP_ATOMIC64K | SQLITE_IOCAP_SAFE_APPEND |
+               SQLITE_IOCAP_POWERSAFE_OVERWRITE | SQLITE_IOCAP_BATCH_ATOMIC);
+  }
+  return flags;
+}
+
+static const sqlite3_io_methods zIoMethods = {
+  1,                        /* iVersion, no shared memory or mmap */
+  zClose,
+  zRead,
+  zWrite,
+  zTruncate,
+  zSync,
+  zFileSize,
+  zLock,
+  zUnlock,
+  zCheckReservedLock,
+  zFileControl,
+  zSectorSize,
+  zDeviceCharacteristics,
+  NULL,                     /* xShmMap */
+  NULL,                     /* xShmLock */
+  NULL,                     /* xShmBarrier */
+  NULL,                     /* xShmUnmap */
+  NULL,                     /* xFetch */
+  NULL                      /* xUnfetch */
+};
+
+
+/* VFS **********************************************************************/
+
+#define ZBASE(pVfs) ((sqlite3_vfs*)((pVfs)->pAppData))
+
+static int zOpen(sqlite3_vfs* pVfs, const char* zName, sqlite3_file* pFile,
+                 int flags, int* pOutFlags) {
+  ZFile* p = (ZFile*)pFile;
+  sqlite3_vfs* pBase = ZBASE(pVfs);
+  int rc;
+
+  memset(p, 0, sizeof(ZFile));
+  p->pReal = (sqlite3_file*)&p[1];
+  p->isDb = (flags & SQLITE_OPEN_MAIN_DB) != 0;
+  p->iEnd = ZDATA_START;
+
+  rc = pBase->xOpen(pBase, zName, p->pReal, flags, pOutFlags);
+  p->base.pMethods = (rc == SQLITE_OK) ? &zIoMethods : NULL;
+  return rc;
+}
+
+int RSQLite_register_compress_vfs(const char* zName, const char* zBase) {
+  return RSQLite_register_shim_vfs(zName, zBase, (int)sizeof(ZFile), zOpen);
+}
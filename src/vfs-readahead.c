@@ -0,0 +1,362 @@
+/*
+ * A VFS shim that reads ahead when the main database file is read
+ * sequentially.
+ *
+ * Reads that start at or shortly after the end of the previous read are
+ * sequential.  After `readahead_trigger` sequential reads, the next read
+ * that misses the buffer fills it with a larger read starting at the
+ * requested offset, following reads are served from the buffer.  The
+ * read-ahead size starts at 64 KiB and doubles with each fill up to
+ * `readahead_window`, a random read resets it.  Only one buffer is kept per
+ * file, so memory is bounded by the window.
+ *
+ * Writes through the same file update the buffer.  The buffer is dropped
+ * when a read transaction starts, i.e. when a shared lock is taken on the
+ * file or, in WAL mode, on the WAL index, because other connections may
+ * have changed the file in the meantime.
+ *
+ * The window (in bytes, 0 disables read-ahead) and the trigger are set
+ * with the URI parameters or pragmas `readahead_window` and
+ * `readahead_trigger`.  `PRAGMA readahead_stats` reports the number of
+ * reads, buffer hits and fills.  Journal, WAL, and temporary files are
+ * passed through.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "vendor/sqlite3/sqlite3.h"
+#include "vfs.h"
+
+typedef sqlite3_int64 i64;
+
+#define RA_DEFAULT_WINDOW   (1 << 20)
+#define RA_MAX_WINDOW       (64 << 20)
+#define RA_INITIAL_WINDOW   (64 << 10)
+#define RA_DEFAULT_TRIGGER  2
+
+
+/* File *********************************************************************/
+
+typedef struct RFile RFile;
+struct RFile {
+  sqlite3_file base;
+  sqlite3_file* pReal;      /* Underlying file, allocated after this struct */
+  int isDb;                 /* Read ahead? Only for main database files */
+  int eLock;
+
+  int nWindowMax;           /* readahead_window, 0 disables */
+  int nTrigger;             /* readahead_trigger */
+  int nWindow;              /* Size of the next fill */
+  int nRun;                 /* Number of sequential reads in a row */
+  i64 iLastEnd;             /* End of the previous read */
+
+  unsigned char* aBuf;      /* Read-ahead buffer */
+  int nBufAlloc;
+  i64 iBufOff;              /* Offset of the buffer in the file */
+  int nBufData;             /* Valid bytes in the buffer, 0 if empty */
+
+  i64 nRead;                /* Reads */
+  i64 nHit;                 /* ... served from the buffer */
+  i64 nFill;                /* Read-ahead reads */
+  i64 nFillBytes;           /* ... and their size */
+  i64 nInvalidate;          /* Buffers dropped at the start of a transaction */
+};
+
+static void raInvalidate(RFile* p) {
+  if (p->nBufData > 0) p->nInvalidate++;
+  p->nBufData = 0;
+}
+
+static void raSetWindow(RFile* p, i64 nWindow) {
+  if (nWindow < 0) nWindow = 0;
+  if (nWindow > RA_MAX_WINDOW) nWindow = RA_MAX_WINDOW;
+  p->nWindowMax = (int)nWindow;
+  p->nWindow = p->nWindowMax < RA_INITIAL_WINDOW ? p->nWindowMax : RA_INITIAL_WINDOW;
+
+  /* Release the buffer if it has become larger than the window */
+  if (p->nBufAlloc > p->nWindowMax) {
+    sqlite3_free(p->aBuf);
+    p->aBuf = NULL;
+    p->nBufAlloc = 0;
+    p->nBufData = 0;
+  }
+}
+
+static int raClose(sqlite3_file* pFile) {
+  RFile* p = (RFile*)pFile;
+  sqlite3_free(p->aBuf);
+  p->aBuf = NULL;
+  return p->pReal->pMethods->xClose(p->pReal);
+}
+
+/* Fills the buffer with up to nWindow bytes starting at iOfst, sets
+ * *pFilled to 0 if read-ahead would not help */
+static int raFill(RFile* p, int iAmt, i64 iOfst, int* pFilled) {
+  i64 nSize;
+  int n, rc;
+
+  *pFilled = 0;
+  rc = p->pReal->pMethods->xFileSize(p->pReal, &nSize);
+  if (rc != SQLITE_OK) return rc;
+
+  n = p->nWindow;
+  if (nSize - iOfst < n) n = (int)(nSize - iOfst);
+  if (n <= iAmt) return SQLITE_OK;
+
+  if (p->nBufAlloc < n) {
+    unsigned char* aNew = sqlite3_realloc(p->aBuf, p->nWindow);
+    if (aNew == NULL) return SQLITE_OK;
+    p->aBuf = aNew;
+    p->nBufAlloc = p->nWindow;
+  }
+
+  p->nBufData = 0;
+  rc = p->pReal->pMethods->xRead(p->pReal, p->aBuf, n, iOfst);
+  if (rc != SQLITE_OK) return rc == SQLITE_IOERR_SHORT_READ ? SQLITE_OK : rc;
+
+  p->iBufOff = iOfst;
+  p->nBufData = n;
+  *pFilled = 1;
+  p->nFill++;
+  p->nFillBytes += n;
+
+  if (p->nWindow < p->nWindowMax) {
+    p->nWindow = (p->nWindow > p->nWindowMax / 2) ? p->nWindowMax : p->nWindow * 2;
+  }
+  return SQLITE_OK;
+}
+
+static int raRead(sqlite3_file* pFile, void* zBuf, int iAmt, sqlite3_int64 iOfst) {
+  RFile* p = (RFile*)pFile;
+  int rc;
+
+  if (!p->isDb || p->nWindowMax == 0) {
+    return p->pReal->pMethods->xRead(p->pReal, zBuf, iAmt, iOfst);
+  }
+
+  p->nRead++;
+
+  if (p->nBufData > 0 && iOfst >= p->iBufOff &&
+      iOfst + iAmt <= p->iBufOff + p->nBufData) {
+    memcpy(zBuf, p->aBuf + (iOfst - p->iBufOff), iAmt);
+    p->nHit++;
+    p->nRun++;
+    p->iLastEnd = iOfst + iAmt;
+    return SQLITE_OK;
+  }
+
+  /* Small forward gaps, e.g. skipped overflow or freelist pages, count as
+   * sequential */
+  if (iOfst >= p->iLastEnd && iOfst - p->iLastEnd <= p->nWindow) {
+    p->nRun++;
+  } else {
+    p->nRun = 0;
+    p->nWindow = p->nWindowMax < RA_INITIAL_WINDOW ? p->nWindowMax : RA_INITIAL_WINDOW;
+  }
+  p->iLastEnd = iOfst + iAmt;
+
+  if (p->nRun >= p->nTrigger && iAmt < p->nWindow) {
+    int isFilled;
+    rc = raFill(p, iAmt, iOfst, &isFilled);
+    if (rc != SQLITE_OK) return rc;
+    if (isFilled) {
+      memcpy(zBuf, p->aBuf, iAmt);
+      return SQLITE_OK;
+    }
+  }
+
+  return p->pReal->pMethods->xRead(p->pReal, zBuf, iAmt, iOfst);
+}
+
+static int raWrite(sqlite3_file* pFile, const void* zBuf, int iAmt, sqlite3_int64 iOfst) {
+  RFile* p = (RFile*)pFile;
+
+  /* Keep the overlapping part of the buffer up to date */
+  if (p->nBufData > 0) {
+    i64 iStart = iOfst > p->iBufOff ? iOfst : p->iBufOff;
+    i64 iEnd = iOfst + iAmt;
+    if (iEnd > p->iBufOff + p->nBufData) iEnd = p->iBufOff + p->nBufData;
+    if (iStart < iEnd) {
+      memcpy(p->aBuf + (iStart - p->iBufOff),
+             (const unsigned char*)zBuf + (iStart - iOfst), (size_t)(iEnd - iStart));
+    }
+  }
+
+  return p->pReal->pMethods->xWrite(p->pReal, zBuf, iAmt, iOfst);
+}
+
+static int raTruncate(sqlite3_file* pFile, sqlite3_int64 size) {
+  RFile* p = (RFile*)pFile;
+  if (p->nBufData > 0 && p->iBufOff + p->nBufData > size) {
+    p->nBufData = (size > p->iBufOff) ? (int)(size - p->iBufOff) : 0;
+  }
+  return p->pReal->pMethods->xTruncate(p->pReal, size);
+}
+
+static int raSync(sqlite3_file* pFile, int flags) {
+  RFile* p = (RFile*)pFile;
+  return p->pReal->pMethods->xSync(p->pReal, flags);
+}
+
+static int raFileSize(sqlite3_file* pFile, sqlite3_int64* pSize) {
+  RFile* p = (RFile*)pFile;
+  return p->pReal->pMethods->xFileSize(p->pReal, pSize);
+}
+
+static int raLock(sqlite3_file* pFile, int eLock) {
+  RFile* p = (RFile*)pFile;
+  int rc = p->pReal->pMethods->xLock(p->pReal, eLock);
+  if (rc == SQLITE_OK) {
+    if (p->eLock == SQLITE_LOCK_NONE) raInvalidate(p);
+    p->eLock = eLock;
+  }
+  return rc;
+}
+
+static int raUnlock(sqlite3_file* pFile, int eLock) {
+  RFile* p = (RFile*)pFile;
+  int rc = p->pReal->pMethods->xUnlock(p->pReal, eLock);
+  if (rc == SQLITE_OK) p->eLock = eLock;
+  return rc;
+}
+
+static int raCheckReservedLock(sqlite3_file* pFile, int* pResOut) {
+  RFile* p = (RFile*)pFile;
+  return p->pReal->pMethods->xCheckReservedLock(p->pReal, pResOut);
+}
+
+static int raFileControl(sqlite3_file* pFile, int op, void* pArg) {
+  RFile* p = (RFile*)pFile;
+  int rc;
+
+  if (op == SQLITE_FCNTL_PRAGMA && p->isDb) {
+    char** azArg = (char**)pArg;
+    if (sqlite3_stricmp(azArg[1], "readahead_window") == 0) {
+      if (azArg[2]) raSetWindow(p, strtoll(azArg[2], NULL, 10));
+      azArg[0] = sqlite3_mprintf("%d", p->nWindowMax);
+      return SQLITE_OK;
+    }
+    if (sqlite3_stricmp(azArg[1], "readahead_trigger") == 0) {
+      if (azArg[2]) {
+        int n = atoi(azArg[2]);
+        p->nTrigger = n < 1 ? 1 : n;
+      }
+      azArg[0] = sqlite3_mprintf("%d", p->nTrigger);
+      return SQLITE_OK;
+    }
+    if (sqlite3_stricmp(azArg[1], "readahead_stats") == 0) {
+      azArg[0] = sqlite3_mprintf(
+        "window=%d trigger=%d reads=%lld hits=%lld fills=%lld fill_bytes=%lld "
+        "invalidations=%lld",
+        p->nWindowMax, p->nTrigger, p->nRead, p->nHit, p->nFill, p->nFillBytes,
+        p->nInvalidate
+      );
+      return SQLITE_OK;
+    }
+  }
+
+  rc = p->pReal->pMethods->xFileControl(p->pReal, op, pArg);
+  if (rc == SQLITE_OK && op == SQLITE_FCNTL_VFSNAME) {
+    *(char**)pArg = sqlite3_mprintf("readahead/%z", *(char**)pArg);
+  }
+  return rc;
+}
+
+static int raSectorSize(sqlite3_file* pFile) {
+  RFile* p = (RFile*)pFile;
+  return p->pReal->pMethods->xSectorSize(p->pReal);
+}
+
+static int raDeviceCharacteristics(sqlite3_file* pFile) {
+  RFile* p = (RFile*)pFile;
+  return p->pReal->pMethods->xDeviceCharacteristics(p->pReal);
+}
+
+static int raShmMap(sqlite3_file* pFile, int iPg, int pgsz, int bExtend, void volatile** pp) {
+  RFile* p = (RFile*)pFile;
+  return p->pReal->pMethods->xShmMap(p->pReal, iPg, pgsz, bExtend, pp);
+}
+
+static int raShmLock(sqlite3_file* pFile, int offset, int n, int flags) {
+  RFile* p = (RFile*)pFile;
+  /* A WAL read transaction starts with a shared lock on a read mark, a
+   * checkpoint by another connection may have changed the file */
+  if ((flags & (SQLITE_SHM_LOCK | SQLITE_SHM_SHARED)) == (SQLITE_SHM_LOCK | SQLITE_SHM_SHARED)) {
+    raInvalidate(p);
+  }
+  return p->pReal->pMethods->xShmLock(p->pReal, offset, n, flags);
+}
+
+static void raShmBarrier(sqlite3_file* pFile) {
+  RFile* p = (RFile*)pFile;
+  p->pReal->pMethods->xShmBarrier(p->pReal);
+}
+
+static int raShmUnmap(sqlite3_file* pFile, int deleteFlag) {
+  RFile* p = (RFile*)pFile;
+  return p->pReal->pMethods->xShmUnmap(p->pReal, deleteFlag);
+}
+
+static int raFetch(sqlite3_file* pFile, sqlite3_int64 iOfst, int iAmt, void** pp) {
+  RFile* p = (RFile*)pFile;
+  return p->pReal->pMethods->xFetch(p->pReal, iOfst, iAmt, pp);
+}
+
+static int raUnfetch(sqlite3_file* pFile, sqlite3_int64 iOfst, void* pPage) {
+  RFile* p = (RFile*)pFile;
+  return p->pReal->pMethods->xUnfetch(p->pReal, iOfst, pPage);
+}
+
+/* One table per version, the shim supports what the underlying file does */
+#define READAHEAD_IO_METHODS(iVersion) {                                \
+  iVersion, raClose, raRead, raWrite, raTruncate, raSync, raFileSize,   \
+  raLock, raUnlock, raCheckReservedLock, raFileControl, raSectorSize,   \
+  raDeviceCharacteristics, raShmMap, raShmLock, raShmBarrier,           \
+  raShmUnmap, raFetch, raUnfetch                                        \
+}
+
+static const sqlite3_io_methods raIoMethods[3] = {
+  READAHEAD_IO_METHODS(1),
+  READAHEAD_IO_METHODS(2),
+  READAHEAD_IO_METHODS(3)
+};
+
+
+/* VFS **********************************************************************/
+
+#define RABASE(pVfs) ((sqlite3_vfs*)((pVfs)->pAppData))
+
+static int raOpen(sqlite3_vfs* pVfs, const char* zName, sqlite3_file* pFile,
+                  int flags, int* pOutFlags) {
+  RFile* p = (RFile*)pFile;
+  sqlite3_vfs* pBase = RABASE(pVfs);
+  int rc, iVersion;
+
+  memset(p, 0, sizeof(RFile));
+  p->pReal = (sqlite3_file*)&p[1];
+  p->isDb = (flags & SQLITE_OPEN_MAIN_DB) != 0;
+  p->nTrigger = RA_DEFAULT_TRIGGER;
+  raSetWindow(p, RA_DEFAULT_WINDOW);
+  if (p->isDb && zName != NULL) {
+    int nTrigger;
+    raSetWindow(p, sqlite3_uri_int64(zName, "readahead_window", RA_DEFAULT_WINDOW));
+    nTrigger = (int)sqlite3_uri_int64(zName, "readahead_trigger", RA_DEFAULT_TRIGGER);
+    p->nTrigger = nTrigger < 1 ? 1 : nTrigger;
+  }
+
+  rc = pBase->xOpen(pBase, zName, p->pReal, flags, pOutFlags);
+  if (rc != SQLITE_OK) {
+    p->base.pMethods = NULL;
+    return rc;
+  }
+
+  iVersion = p->pReal->pMethods->iVersion;
+  if (iVersion < 1) iVersion = 1;
+  if (iVersion > 3) iVersion = 3;
+  p->base.pMethods = &raIoMethods[iVersion - 1];
+  return SQLITE_OK;
+}
+
+int RSQLite_register_readahead_vfs(const char* zName, const char* zBase) {
+  return RSQLite_register_shim_vfs(zName, zBase, (int)sizeof(RFile), raOpen);
+}
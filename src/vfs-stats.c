@@ -0,0 +1,385 @@
+/*
+ * A pass-through VFS shim that counts I/O operations.
+ *
+ * Statistics are collected per main database file.  Journal and WAL files
+ * are attributed to their database.  Temporary files (temporary databases,
+ * statement journals, sorter files) have no database, they are attributed
+ * to the database that was last locked by the same thread, which is the
+ * database of the statement that opened them.
+ *
+ * Reads, writes, syncs and locks are timed and sorted into a latency
+ * histogram with buckets of increasing powers of ten, from < 10us to >= 1s.
+ * Failed lock attempts are counted separately; the time spent waiting for a
+ * lock is spent in the busy handler and is not included.
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include <string.h>
+#include "vendor/sqlite3/sqlite3.h"
+#include "vfs.h"
+
+typedef sqlite3_int64 i64;
+
+#if defined(_MSC_VER)
+#define STATS_THREAD_LOCAL __declspec(thread)
+#else
+#define STATS_THREAD_LOCAL __thread
+#endif
+
+
+/* Statistics blocks *********************************************************/
+
+typedef struct SStats SStats;
+struct SStats {
+  RSQLite_io_stats s;
+  int nRef;
+  SStats* pNext;            /* List of live blocks */
+};
+
+/* Live blocks, protected by SQLITE_MUTEX_STATIC_VFS3 */
+static SStats* pLive = NULL;
+
+/* Block of the database that was last locked by this thread, if alive */
+static STATS_THREAD_LOCAL SStats* pCurrent = NULL;
+
+static sqlite3_mutex* sMutex(void) {
+  return sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS3);
+}
+
+static SStats* sStatsNew(void) {
+  SStats* p = sqlite3_malloc(sizeof(SStats));
+  if (p == NULL) return NULL;
+  memset(p, 0, sizeof(SStats));
+  p->nRef = 1;
+
+  sqlite3_mutex_enter(sMutex());
+  p->pNext = pLive;
+  pLive = p;
+  sqlite3_mutex_leave(sMutex());
+  return p;
+}
+
+/* Returns a new reference to the current block of this thread, if any */
+static SStats* sStatsCurrent(void) {
+  SStats* p;
+
+  sqlite3_mutex_enter(sMutex());
+  for (p = pLive; p != NULL; p = p->pNext) {
+    if (p == pCurrent) {
+      p->nRef++;
+      break;
+    }
+  }
+  sqlite3_mutex_leave(sMutex());
+  return p;
+}
+
+static SStats* sStatsRef(SStats* p) {
+  sqlite3_mutex_enter(sMutex());
+  p->nRef++;
+  sqlite3_mutex_leave(sMutex());
+  return p;
+}
+
+static void sStatsUnref(SStats* p) {
+  int isDead;
+
+  if (p == NULL) return;
+
+  sqlite3_mutex_enter(sMutex());
+  isDead = (--p->nRef == 0);
+  if (isDead) {
+    SStats** pp;
+    for (pp = &pLive; *pp != NULL; pp = &(*pp)->pNext) {
+      if (*pp == p) {
+        *pp = p->pNext;
+        break;
+      }
+    }
+  }
+  sqlite3_mutex_leave(sMutex());
+
+  if (isDead) {
+    if (pCurrent == p) pCurrent = NULL;
+    sqlite3_free(p);
+  }
+}
+
+/* Monotonic time in microseconds */
+static i64 sNow(void) {
+#ifdef _WIN32
+  LARGE_INTEGER f, c;
+  QueryPerformanceFrequency(&f);
+  QueryPerformanceCounter(&c);
+  return (c.QuadPart / f.QuadPart) * 1000000 + (c.QuadPart % f.QuadPart) * 1000000 / f.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (i64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+
+/* File *********************************************************************/
+
+typedef struct SFile SFile;
+struct SFile {
+  sqlite3_file base;
+  sqlite3_file* pReal;      /* Underlying file, allocated after this struct */
+  int eType;                /* RSQLITE_IO_MAIN etc. */
+  SStats* pStats;           /* NULL for temporary files without a database */
+};
+
+static RSQLite_io_counts* sCounts(SFile* p) {
+  return p->pStats ? &p->pStats->s.aType[p->eType] : NULL;
+}
+
+static void sRecord(RSQLite_io_counts* c, int eOp, i64 tStart) {
+  i64 t = sNow() - tStart;
+  i64 lim = 10;
+  int i = 0;
+
+  while (i < RSQLITE_IO_NBUCKET - 1 && t >= lim) {
+    i++;
+    lim *= 10;
+  }
+  c->aTime[eOp] += t;
+  c->aHist[eOp][i]++;
+}
+
+static int sClose(sqlite3_file* pFile) {
+  SFile* p = (SFile*)pFile;
+  int rc = p->pReal->pMethods->xClose(p->pReal);
+  sStatsUnref(p->pStats);
+  p->pStats = NULL;
+  return rc;
+}
+
+static int sRead(sqlite3_file* pFile, void* zBuf, int iAmt, sqlite3_int64 iOfst) {
+  SFile* p = (SFile*)pFile;
+  RSQLite_io_counts* c = sCounts(p);
+  i64 t = sNow();
+  int rc = p->pReal->pMethods->xRead(p->pReal, zBuf, iAmt, iOfst);
+  if (c) {
+    c->nRead++;
+    if (rc == SQLITE_OK || rc == SQLITE_IOERR_SHORT_READ) c->nReadBytes += iAmt;
+    sRecord(c, RSQLITE_IO_READ, t);
+  }
+  return rc;
+}
+
+static int sWrite(sqlite3_file* pFile, const void* zBuf, int iAmt, sqlite3_int64 iOfst) {
+  SFile* p = (SFile*)pFile;
+  RSQLite_io_counts* c = sCounts(p);
+  i64 t = sNow();
+  int rc = p->pReal->pMethods->xWrite(p->pReal, zBuf, iAmt, iOfst);
+  if (c) {
+    c->nWrite++;
+    if (rc == SQLITE_OK) c->nWriteBytes += iAmt;
+    sRecord(c, RSQLITE_IO_WRITE, t);
+  }
+  return rc;
+}
+
+static int sTruncate(sqlite3_file* pFile, sqlite3_int64 size) {
+  SFile* p = (SFile*)pFile;
+  RSQLite_io_counts* c = sCounts(p);
+  if (c) c->nTruncate++;
+  return p->pReal->pMethods->xTruncate(p->pReal, size);
+}
+
+static int sSync(sqlite3_file* pFile, int flags) {
+  SFile* p = (SFile*)pFile;
+  RSQLite_io_counts* c = sCounts(p);
+  i64 t = sNow();
+  int rc = p->pReal->pMethods->xSync(p->pReal, flags);
+  if (c) {
+    c->nSync++;
+    sRecord(c, RSQLITE_IO_SYNC, t);
+  }
+  return rc;
+}
+
+static int sFileSize(sqlite3_file* pFile, sqlite3_int64* pSize) {
+  SFile* p = (SFile*)pFile;
+  return p->pReal->pMethods->xFileSize(p->pReal, pSize);
+}
+
+static int sLock(sqlite3_file* pFile, int eLock) {
+  SFile* p = (SFile*)pFile;
+  RSQLite_io_counts* c = sCounts(p);
+  i64 t = sNow();
+  int rc = p->pReal->pMethods->xLock(p->pReal, eLock);
+  if (c) {
+    c->nLock++;
+    if (rc == SQLITE_BUSY) c->nLockBusy++;
+    sRecord(c, RSQLITE_IO_LOCK, t);
+  }
+  if (p->eType == RSQLITE_IO_MAIN) pCurrent = p->pStats;
+  return rc;
+}
+
+static int sUnlock(sqlite3_file* pFile, int eLock) {
+  SFile* p = (SFile*)pFile;
+  RSQLite_io_counts* c = sCounts(p);
+  if (c) c->nUnlock++;
+  return p->pReal->pMethods->xUnlock(p->pReal, eLock);
+}
+
+static int sCheckReservedLock(sqlite3_file* pFile, int* pResOut) {
+  SFile* p = (SFile*)pFile;
+  return p->pReal->pMethods->xCheckReservedLock(p->pReal, pResOut);
+}
+
+static int sFileControl(sqlite3_file* pFile, int op, void* pArg) {
+  SFile* p = (SFile*)pFile;
+  int rc;
+
+  if (op == RSQLITE_FCNTL_VFS_STATS || op == RSQLITE_FCNTL_VFS_STATS_RESET) {
+    if (p->eType != RSQLITE_IO_MAIN || p->pStats == NULL) return SQLITE_NOTFOUND;
+    if (op == RSQLITE_FCNTL_VFS_STATS) {
+      memcpy(pArg, &p->pStats->s, sizeof(RSQLite_io_stats));
+    } else {
+      memset(&p->pStats->s, 0, sizeof(RSQLite_io_stats));
+    }
+    return SQLITE_OK;
+  }
+
+  rc = p->pReal->pMethods->xFileControl(p->pReal, op, pArg);
+  if (rc == SQLITE_OK && op == SQLITE_FCNTL_VFSNAME) {
+    *(char**)pArg = sqlite3_mprintf("stats/%z", *(char**)pArg);
+  }
+  return rc;
+}
+
+static int sSectorSize(sqlite3_file* pFile) {
+  SFile* p = (SFile*)pFile;
+  return p->pReal->pMethods->xSectorSize(p->pReal);
+}
+
+static int sDeviceCharacteristics(sqlite3_file* pFile) {
+  SFile* p = (SFile*)pFile;
+  return p->pReal->pMethods->xDeviceCharacteristics(p->pReal);
+}
+
+static int sShmMap(sqlite3_file* pFile, int iPg, int pgsz, int bExtend, void volatile** pp) {
+  SFile* p = (SFile*)pFile;
+  return p->pReal->pMethods->xShmMap(p->pReal, iPg, pgsz, bExtend, pp);
+}
+
+static int sShmLock(sqlite3_file* pFile, int offset, int n, int flags) {
+  SFile* p = (SFile*)pFile;
+  RSQLite_io_counts* c = sCounts(p);
+  if (c) c->nShmLock++;
+  return p->pReal->pMethods->xShmLock(p->pReal, offset, n, flags);
+}
+
+static void sShmBarrier(sqlite3_file* pFile) {
+  SFile* p = (SFile*)pFile;
+  p->pReal->pMethods->xShmBarrier(p->pReal);
+}
+
+static int sShmUnmap(sqlite3_file* pFile, int deleteFlag) {
+  SFile* p = (SFile*)pFile;
+  return p->pReal->pMethods->xShmUnmap(p->pReal, deleteFlag);
+}
+
+static int sFetch(sqlite3_file* pFile, sqlite3_int64 iOfst, int iAmt, void** pp) {
+  SFile* p = (SFile*)pFile;
+  RSQLite_io_counts* c = sCounts(p);
+  int rc = p->pReal->pMethods->xFetch(p->pReal, iOfst, iAmt, pp);
+  /* Memory-mapped pages are counted as reads without latency */
+  if (c && rc == SQLITE_OK && *pp != NULL) {
+    c->nRead++;
+    c->nReadBytes += iAmt;
+  }
+  return rc;
+}
+
+static int sUnfetch(sqlite3_file* pFile, sqlite3_int64 iOfst, void* pPage) {
+  SFile* p = (SFile*)pFile;
+  return p->pReal->pMethods->xUnfetch(p->pReal, iOfst, pPage);
+}
+
+/* One table per version, the shim supports what the underlying file does */
+#define STATS_IO_METHODS(iVersion) {                                    \
+  iVersion, sClose, sRead, sWrite, sTruncate, sSync, sFileSize,         \
+  sLock, sUnlock, sCheckReservedLock, sFileControl, sSectorSize,        \
+  sDeviceCharacteristics, sShmMap, sShmLock, sShmBarrier, sShmUnmap,    \
+  sFetch, sUnfetch                                                      \
+}
+
+static const sqlite3_io_methods sIoMethods[3] = {
+  STATS_IO_METHODS(1),
+  STATS_IO_METHODS(2),
+  STATS_IO_METHODS(3)
+};
+
+
+/* VFS **********************************************************************/
+
+#define SBASE(pVfs) ((sqlite3_vfs*)((pVfs)->pAppData))
+
+static int sIsStatsFile(sqlite3_file* pFile) {
+  return pFile->pMethods == &sIoMethods[0] || pFile->pMethods == &sIoMethods[1] ||
+    pFile->pMethods == &sIoMethods[2];
+}
+
+static int sFileType(int flags) {
+  if (flags & SQLITE_OPEN_MAIN_DB) return RSQLITE_IO_MAIN;
+  if (flags & (SQLITE_OPEN_MAIN_JOURNAL | SQLITE_OPEN_SUPER_JOURNAL)) return RSQLITE_IO_JOURNAL;
+  if (flags & SQLITE_OPEN_WAL) return RSQLITE_IO_WAL;
+  return RSQLITE_IO_TEMP;
+}
+
+static int sOpen(sqlite3_vfs* pVfs, const char* zName, sqlite3_file* pFile,
+                 int flags, int* pOutFlags) {
+  SFile* p = (SFile*)pFile;
+  sqlite3_vfs* pBase = SBASE(pVfs);
+  int rc, iVersion;
+
+  memset(p, 0, sizeof(SFile));
+  p->pReal = (sqlite3_file*)&p[1];
+  p->eType = sFileType(flags);
+
+  if (p->eType == RSQLITE_IO_MAIN) {
+    p->pStats = sStatsNew();
+    if (p->pStats == NULL) return SQLITE_NOMEM;
+  } else {
+    sqlite3_file* pDb = NULL;
+    if (zName != NULL && (p->eType == RSQLITE_IO_JOURNAL || p->eType == RSQLITE_IO_WAL)) {
+      pDb = sqlite3_database_file_object(zName);
+    }
+    if (pDb != NULL && sIsStatsFile(pDb)) {
+      p->pStats = sStatsRef(((SFile*)pDb)->pStats);
+    } else {
+      /* The database is not opened through this shim directly */
+      p->pStats = sStatsCurrent();
+    }
+  }
+
+  rc = pBase->xOpen(pBase, zName, p->pReal, flags, pOutFlags);
+  if (rc != SQLITE_OK) {
+    sStatsUnref(p->pStats);
+    p->pStats = NULL;
+    p->base.pMethods = NULL;
+    return rc;
+  }
+
+  if (p->pStats) p->pStats->s.aType[p->eType].nOpen++;
+  if (p->eType == RSQLITE_IO_MAIN) pCurrent = p->pStats;
+
+  iVersion = p->pReal->pMethods->iVersion;
+  if (iVersion < 1) iVersion = 1;
+  if (iVersion > 3) iVersion = 3;
+  p->base.pMethods = &sIoMethods[iVersion - 1];
+  return SQLITE_OK;
+}
+
+int RSQLite_register_stats_vfs(const char* zName, const char* zBase) {
+  return RSQLite_register_shim_vfs(zName, zBase, (int)sizeof(SFile), sOpen);
+}
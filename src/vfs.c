@@ -0,0 +1,107 @@
+/*
+ * Common parts of the VFS shims: the VFS methods that only forward to the
+ * base VFS, and the registration of a shim.
+ */
+
+#include <string.h>
+#include "vendor/sqlite3/sqlite3.h"
+#include "vfs.h"
+
+#define BASE(pVfs) ((sqlite3_vfs*)((pVfs)->pAppData))
+
+static int shimDelete(sqlite3_vfs* pVfs, const char* zName, int syncDir) {
+  return BASE(pVfs)->xDelete(BASE(pVfs), zName, syncDir);
+}
+
+static int shimAccess(sqlite3_vfs* pVfs, const char* zName, int flags, int* pResOut) {
+  return BASE(pVfs)->xAccess(BASE(pVfs), zName, flags, pResOut);
+}
+
+static int shimFullPathname(sqlite3_vfs* pVfs, const char* zName, int nOut, char* zOut) {
+  return BASE(pVfs)->xFullPathname(BASE(pVfs), zName, nOut, zOut);
+}
+
+static void* shimDlOpen(sqlite3_vfs* pVfs, const char* zFilename) {
+  return BASE(pVfs)->xDlOpen(BASE(pVfs), zFilename);
+}
+
+static void shimDlError(sqlite3_vfs* pVfs, int nByte, char* zErrMsg) {
+  BASE(pVfs)->xDlError(BASE(pVfs), nByte, zErrMsg);
+}
+
+static void (*shimDlSym(sqlite3_vfs* pVfs, void* pHandle, const char* zSymbol))(void) {
+  return BASE(pVfs)->xDlSym(BASE(pVfs), pHandle, zSymbol);
+}
+
+static void shimDlClose(sqlite3_vfs* pVfs, void* pHandle) {
+  BASE(pVfs)->xDlClose(BASE(pVfs), pHandle);
+}
+
+static int shimRandomness(sqlite3_vfs* pVfs, int nByte, char* zOut) {
+  return BASE(pVfs)->xRandomness(BASE(pVfs), nByte, zOut);
+}
+
+static int shimSleep(sqlite3_vfs* pVfs, int microseconds) {
+  return BASE(pVfs)->xSleep(BASE(pVfs), microseconds);
+}
+
+static int shimCurrentTime(sqlite3_vfs* pVfs, double* pTime) {
+  return BASE(pVfs)->xCurrentTime(BASE(pVfs), pTime);
+}
+
+static int shimGetLastError(sqlite3_vfs* pVfs, int nByte, char* zOut) {
+  return BASE(pVfs)->xGetLastError(BASE(pVfs), nByte, zOut);
+}
+
+static int shimCurrentTimeInt64(sqlite3_vfs* pVfs, sqlite3_int64* pTime) {
+  sqlite3_vfs* pBase = BASE(pVfs);
+  if (pBase->iVersion >= 2 && pBase->xCurrentTimeInt64) {
+    return pBase->xCurrentTimeInt64(pBase, pTime);
+  } else {
+    double r;
+    int rc = pBase->xCurrentTime(pBase, &r);
+    *pTime = (sqlite3_int64)(r * 86400000.0);
+    return rc;
+  }
+}
+
+int RSQLite_register_shim_vfs(const char* zName, const char* zBase, int szFile,
+                              int (*xOpen)(sqlite3_vfs*, const char*, sqlite3_file*, int, int*)) {
+  sqlite3_vfs* pBase;
+  sqlite3_vfs* pNew;
+  size_t nName;
+  int rc;
+
+  if (sqlite3_vfs_find(zName) != NULL) return SQLITE_OK;
+  pBase = sqlite3_vfs_find(zBase);
+  if (pBase == NULL) return SQLITE_NOTFOUND;
+
+  nName = strlen(zName);
+  pNew = sqlite3_malloc64(sizeof(sqlite3_vfs) + nName + 1);
+  if (pNew == NULL) return SQLITE_NOMEM;
+  memset(pNew, 0, sizeof(sqlite3_vfs));
+  memcpy(&pNew[1], zName, nName + 1);
+
+  pNew->iVersion = 2;
+  pNew->szOsFile = szFile + pBase->szOsFile;
+  pNew->mxPathname = pBase->mxPathname;
+  pNew->zName = (const char*)&pNew[1];
+  pNew->pAppData = pBase;
+  pNew->xOpen = xOpen;
+  pNew->xDelete = shimDelete;
+  pNew->xAccess = shimAccess;
+  pNew->xFullPathname = shimFullPathname;
+  pNew->xDlOpen = shimDlOpen;
+  pNew->xDlError = shimDlError;
+  pNew->xDlSym = shimDlSym;
+  pNew->xDlClose = shimDlClose;
+  pNew->xRandomness = shimRandomness;
+  pNew->xSleep = shimSleep;
+  pNew->xCurrentTime = shimCurrentTime;
+  pNew->xGetLastError = shimGetLastError;
+  pNew->xCurrentTimeInt64 = shimCurrentTimeInt64;
+
+  rc = sqlite3_vfs_register(pNew, 0);
+  if (rc != SQLITE_OK) sqlite3_free(pNew);
+  return rc;
+}
@@ -0,0 +1,84 @@
+#ifndef __RSQLITE_VFS_H
+#define __RSQLITE_VFS_H
+
+// Requires sqlite3.h, included through sqlite3-cpp.h in C++ code
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* VFS shims that are layered on top of another VFS.  Each function registers
+ * a new VFS called zName that forwards to the VFS called zBase, or to the
+ * default VFS if zBase is NULL.  Registering a name twice is a no-op.
+ */
+
+/* Stores the pages of main database files compressed */
+int RSQLite_register_compress_vfs(const char* zName, const char* zBase);
+
+/* Counts I/O operations per file type */
+int RSQLite_register_stats_vfs(const char* zName, const char* zBase);
+
+/* Reads ahead when the main database file is read sequentially */
+int RSQLite_register_readahead_vfs(const char* zName, const char* zBase);
+
+/* Registers a shim with its own xOpen, which stores the base VFS in
+ * pAppData.  szFile is the size of the file structure of the shim, the file
+ * of the base VFS follows it.  All other methods forward to the base VFS.
+ */
+int RSQLite_register_shim_vfs(const char* zName, const char* zBase, int szFile,
+                              int (*xOpen)(sqlite3_vfs*, const char*, sqlite3_file*, int, int*));
+
+
+/* I/O statistics, collected per main database file together with the
+ * journal, WAL and temporary files used with it.  Query with
+ * sqlite3_file_control(db, schema, RSQLITE_FCNTL_VFS_STATS, &stats),
+ * reset with RSQLITE_FCNTL_VFS_STATS_RESET.
+ */
+
+#define RSQLITE_FCNTL_VFS_STATS        0x52530001
+#define RSQLITE_FCNTL_VFS_STATS_RESET  0x52530002
+
+/* File types */
+#define RSQLITE_IO_MAIN     0
+#define RSQLITE_IO_JOURNAL  1
+#define RSQLITE_IO_WAL      2
+#define RSQLITE_IO_TEMP     3
+#define RSQLITE_IO_NTYPE    4
+
+/* Timed operations */
+#define RSQLITE_IO_READ     0
+#define RSQLITE_IO_WRITE    1
+#define RSQLITE_IO_SYNC     2
+#define RSQLITE_IO_LOCK     3
+#define RSQLITE_IO_NOP      4
+
+/* Latency buckets: < 10us, < 100us, ..., < 1s, >= 1s */
+#define RSQLITE_IO_NBUCKET  7
+
+typedef struct RSQLite_io_counts RSQLite_io_counts;
+struct RSQLite_io_counts {
+  sqlite3_int64 nOpen;
+  sqlite3_int64 nRead;
+  sqlite3_int64 nReadBytes;
+  sqlite3_int64 nWrite;
+  sqlite3_int64 nWriteBytes;
+  sqlite3_int64 nSync;
+  sqlite3_int64 nTruncate;
+  sqlite3_int64 nLock;
+  sqlite3_int64 nLockBusy;     /* xLock() calls that returned SQLITE_BUSY */
+  sqlite3_int64 nUnlock;
+  sqlite3_int64 nShmLock;      /* WAL index locks */
+  sqlite3_int64 aTime[RSQLITE_IO_NOP];  /* Microseconds spent per operation */
+  sqlite3_int64 aHist[RSQLITE_IO_NOP][RSQLITE_IO_NBUCKET];
+};
+
+typedef struct RSQLite_io_stats RSQLite_io_stats;
+struct RSQLite_io_stats {
+  RSQLite_io_counts aType[RSQLITE_IO_NTYPE];
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RSQLITE_VFS_H